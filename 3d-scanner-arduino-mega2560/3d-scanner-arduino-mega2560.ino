@@ -33,6 +33,7 @@ void setup() {
 }
 
 void loop() {
-  Log::info()("READY");
+  // the command protocol's prompt, so never subject to log settings
+  Serial.println("READY");
   control.run_command_processor();
 }
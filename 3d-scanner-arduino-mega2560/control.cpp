@@ -26,6 +26,9 @@ SOFTWARE.
 #include "rcode.hpp"
 #include <avr/wdt.h>
 #include <Arduino.h>
+#include <EEPROM.h>
+#include <limits.h>
+#include <stddef.h>
 
 namespace 
   {
@@ -38,6 +41,27 @@ namespace
     constexpr int   screw_max_height_mm_      = 200;
     constexpr auto  screw_travel_per_turn_mm_ = screw_pitch_mm_ * screw_starts_;
     constexpr auto  screw_max_turns_          = screw_max_height_mm_ / screw_travel_per_turn_mm_;
+    // shorter than the sensor's timing budget, so continuous ranging runs
+    // back to back
+    constexpr uint16_t continuous_ranging_period_ms_ = 0;
+    // serial link; system.baud may switch to any of these.  The 16 MHz clock
+    // divides the ones above 115200 exactly.
+    constexpr long      default_baud_             = 115200;
+    constexpr long      baud_rates_[]             = { 115200, 250000, 500000, 1000000 };
+    // time for the host to switch its end after reading the confirmation
+    constexpr int       baud_switch_delay_ms_     = 50;
+    // stored configuration; bump the version when Config's meaning changes
+    constexpr int       config_address_           = 0;
+    constexpr uint16_t  config_version_           = 1;
+    // wait_for_motion's keep-alive; well inside the host's 2 s timeout
+    constexpr unsigned long keep_alive_ms_        = 1000;
+    constexpr char          keep_alive_line_[]    = "#busy";
+
+template<typename RecordT>
+    auto record_crc(const RecordT& record) -> uint16_t
+      {
+        return ScanFrame::crc16(reinterpret_cast<const uint8_t*>(&record), offsetof(RecordT, crc));
+      }
   }
 Control::Control()
 : platform_()
@@ -47,14 +71,15 @@ Control::Control()
 auto Control::begin(Mode m) -> void
   {
     platform_.begin();
-    platform_.set_speed(config_.platform_speed_);
     carriage_.begin();
-    carriage_.set_speed(config_.carriage_speed_);
+    const bool stored = load_config();
+    apply_config();
     // initialize I/O pins
     pinMode(limit_switch_min_,  INPUT_PULLUP);
     pinMode(limit_switch_max_,  INPUT_PULLUP);
     // setup serial
-    Serial.begin(115200);
+    baud_ = default_baud_;
+    Serial.begin(baud_);
     while(!Serial) { yield(); }
     // setup TOF sensor
     constexpr bool failure = false;
@@ -67,6 +92,16 @@ auto Control::begin(Mode m) -> void
     // check mode
     if(m == mode_normal)
     {
+      Log::info()(stored? "Using the stored configuration." : "Using the default configuration.");
+      // after a reboot the carriage is where it was left, so homing only has
+      // to travel back from there
+      StoredConfig record;
+      if(read_stored_config(record) && record.parked_position >= 0)
+      {
+        carriage_.set_position(record.parked_position);
+        home_known_ = true;
+        store_parked_position(-1);
+      }
       abs(auto_set_home());
       Serial.println("#ready");
     }
@@ -85,7 +120,10 @@ auto Control::begin(Mode m) -> void
   }
 auto Control::reboot() -> void
   {
-    Log::info()("Rebooting...");
+    Log::info()(LogMessage::rebooting);
+    platform_.stop();
+    carriage_.stop();
+    store_parked_position(home_known_? carriage_.position() : -1);
     delay(reboot_delay_);
     // start watchdog timer
     wdt_enable(WDTO_15MS);
@@ -95,6 +133,8 @@ auto Control::reboot() -> void
 auto Control::halt() -> void
   {
     Serial.println("#break");
+    platform_.stop();
+    carriage_.stop();
     standby_all();
     Serial.println("#terminate");
     Log::info()("Type @reboot to reboot device");
@@ -113,41 +153,102 @@ auto Control::limit_reached(int limit_pin) -> bool
   {
     return digitalRead(limit_pin) == LOW;
   }
-auto Control::seek_limit(int limit_pin, SeekOrientation o) -> seek_count_t 
+// Two-speed homing: a fast approach finds the switch, the carriage backs off
+// and a slow approach closes it again, so the position the switch releases
+// at depends on the slow speed only.  When the switch's distance is known
+// the fast move stops short of it by the back-off distance and the slow
+// approach takes over directly; if the switch is not where it was expected
+// the full search runs instead.
+auto Control::seek_limit(int limit_pin, SeekOrientation o, long known_steps) -> seek_count_t 
   {
-    int count = 0;
-    int orientation = o == SeekOrientation::Forward? 1 : -1;
-    int seek_steps = orientation * config_.carriage_seek_steps_;
-    int back_steps = -orientation;
+    const long  orientation = o == SeekOrientation::Forward? 1 : -1;
+    // A move started by an earlier command (carriage.move.steps returns at
+    // once) is finished first; it changes the distance to the switch.
+    const auto  requested   = carriage_.position();
+    wait_for_motion();
+    const auto  start       = carriage_.position();
+    if(known_steps > 0)
+    {
+      known_steps -= orientation * (start - requested);
+    }
+    const long  backoff     = config_.carriage_seek_steps_;
+    const long  travel      = static_cast<long>(screw_max_turns_) * carriage_.steps_per_revolution();
+    // moves toward the switch until it closes (service() stops the carriage)
+    // or steps run out; true if the switch closed
+    auto approach = [&](long steps, int speed)
+      {
+        if(limit_reached(limit_pin) == false)
+        {
+          carriage_.set_speed(speed);
+          carriage_.move(orientation * steps);
+          wait_for_motion();
+        }
+        return limit_reached(limit_pin);
+      };
+    auto release = [&](int speed)
+      {
+        carriage_.set_speed(speed);
+        while(limit_reached(limit_pin) == true)
+        {
+          carriage_.move(-orientation);
+          wait_for_motion();
+        }
+      };
     carriage_.resume();
-    carriage_.set_speed(config_.carriage_seek_speed_);
-    while(limit_reached(limit_pin) == false)
+    bool found = false;
+    if(known_steps > 0)
+    {
+      if(known_steps > backoff)
+      {
+        carriage_.set_speed(config_.carriage_home_speed_);
+        carriage_.move(orientation * (known_steps - backoff));
+        wait_for_motion();
+      }
+      // landing on the switch means it moved closer: approach again slowly
+      found = limit_reached(limit_pin) == false && approach(2 * backoff, config_.carriage_seek_speed_);
+    }
+    if(found == false && approach(travel + travel / 8, config_.carriage_home_speed_))
     {
-      count += seek_steps;
-      carriage_.step(seek_steps);
+      release(config_.carriage_home_speed_);
+      carriage_.move(-orientation * backoff);
+      wait_for_motion();
+      found = approach(2 * backoff, config_.carriage_seek_speed_);
     }
-    while(limit_reached(limit_pin) == true)
+    if(found == false)
     {
-      count += back_steps;
-      carriage_.step(back_steps);
+      Log::error()(LogMessage::limit_not_found);
     }
+    release(config_.carriage_seek_speed_);
     carriage_.standby();
-    return count;
+    carriage_.set_speed(config_.carriage_speed_);
+    return carriage_.position() - start;
   }
 auto Control::auto_set_max() -> seek_count_t
   {
-    Log::info()("Searching for home...");
-    auto count = seek_limit(limit_switch_max_, SeekOrientation::Forward);
-    Log::info()("Homing complete.");
-    config_.carriage_max_ = count;
+    Log::info()(LogMessage::searching_limit);
+    const long known = home_known_ && span_known_? config_.carriage_max_ - carriage_.position() : 0;
+    auto count = seek_limit(limit_switch_max_, SeekOrientation::Forward, known);
+    Log::info()(LogMessage::limit_found);
+    if(home_known_)
+    {
+      config_.carriage_max_ = static_cast<int>(carriage_.position());
+      span_known_           = true;
+    }
+    else
+    {
+      config_.carriage_max_ = count;
+    }
     return count;
   }
+// After the first homing the carriage position is trusted, so a re-home only
+// travels back to the switch at speed and repeats the short slow approach.
 auto Control::auto_set_home() -> seek_count_t
   {
-    Log::info()("Searching for home...");
-    auto count = seek_limit(limit_switch_min_, SeekOrientation::Reverse);
-    Log::info()("Homing complete.");
-    carriage_position_ = 0;
+    Log::info()(LogMessage::searching_home);
+    auto count = seek_limit(limit_switch_min_, SeekOrientation::Reverse, home_known_? carriage_.position() : 0);
+    Log::info()(LogMessage::homing_complete);
+    carriage_.set_position(0);
+    home_known_ = true;
     return count;
   }
 auto Control::resume_all() -> void
@@ -164,126 +265,442 @@ auto Control::error(const String& msg) -> void
     halt();
   }
 //============================================================================
-// text processing functions
+// stored configuration
 //============================================================================
-auto Control::data_to_bool(const String& d) -> pair<bool, bool>
+auto Control::apply_config() -> void
   {
-    pair<bool, bool> result(false, false);
-    const auto& requested_state = d;
-    if ( requested_state == "0" 
-      || requested_state == "false")
+    platform_.set_speed(config_.platform_speed_);
+    carriage_.set_speed(config_.carriage_speed_);
+    apply_carriage_profile();
+  }
+// replaces config_ with the stored configuration, if there is a valid one
+auto Control::load_config() -> bool
+  {
+    StoredConfig record;
+    if(read_stored_config(record) == false)
     {
-      result.first  = true;
-      result.second = false;
-    } 
-    else 
-    if( requested_state == "1"
-     || requested_state == "true")
+      return false;
+    }
+    config_     = record.config;
+    span_known_ = record.span_known != 0;
+    return true;
+  }
+// A record is only trusted if its version, size and CRC all match; erased
+// EEPROM reads as 0xff and fails every one of them.
+auto Control::read_stored_config(StoredConfig& record) -> bool
+  {
+    EEPROM.get(config_address_, record);
+    return record.version == config_version_
+        && record.size    == sizeof(StoredConfig)
+        && record.crc     == record_crc(record);
+  }
+// EEPROM.put() only writes the bytes that changed, which spares the cells
+auto Control::write_stored_config(StoredConfig& record) -> void
+  {
+    record.version  = config_version_;
+    record.size     = sizeof(StoredConfig);
+    record.crc      = record_crc(record);
+    EEPROM.put(config_address_, record);
+  }
+// only kept alongside a saved configuration
+auto Control::store_parked_position(long position) -> void
+  {
+    StoredConfig record;
+    if(read_stored_config(record) && record.parked_position != position)
     {
-      result.first  = true;
-      result.second = true;
+      record.parked_position = position;
+      write_stored_config(record);
     }
-    return result;
   }
-auto Control::data_to_int(const String& d) -> pair<bool, int>
+//============================================================================
+// text processing functions
+//============================================================================
+// 0 or 1, or either of those or true/false quoted
+auto Control::data_to_bool(const rcode_t& rc) -> pair<bool, bool>
   {
-    pair<bool, int> result(true, 0);
-    // make sure that every character is either a digit, a sign, 
-    // or null terminator
-    for(auto c : d)
+    pair<bool, bool> result(false, false);
+    const auto& requested_state = rc.data();
+    if(rc.type() == rcode_t::Type::integer)
+    {
+      result.first  = rc.integer() == 0 || rc.integer() == 1;
+      result.second = rc.integer() == 1;
+    }
+    else if(rc.type() == rcode_t::Type::string)
     {
-      if((isdigit(c) || c == '-' || c == '+') == false)
+      if ( requested_state == "0" 
+        || requested_state == "false")
+      {
+        result.first  = true;
+        result.second = false;
+      } 
+      else 
+      if( requested_state == "1"
+       || requested_state == "true")
       {
-        result.first = false;
-        break;
+        result.first  = true;
+        result.second = true;
       }
     }
-    if(result.first == true)
+    return result;
+  }
+// int is 16 bits on the AVR, so anything larger goes through data_to_long
+auto Control::data_to_int(const rcode_t& rc) -> pair<bool, int>
+  {
+    auto result = data_to_long(rc);
+    if(result.second < INT_MIN || result.second > INT_MAX)
     {
-      result.second = atoi(d.c_str()); 
+      result.first = false;
     }
-    return result;
+    return pair<bool, int>(result.first, static_cast<int>(result.second));
+  }
+// the parser has already converted the number
+auto Control::data_to_long(const rcode_t& rc) -> pair<bool, long>
+  {
+    return pair<bool, long>(rc.type() == rcode_t::Type::integer, rc.integer());
   }
 auto Control::get_char() -> char
   {
     int ch;
-    while((ch = Serial.read()) == -1) { yield(); }
+    while((ch = Serial.read()) == -1) { service(); }
     return ch;
   }
-auto Control::get_line() -> String
+auto Control::get_line() -> string_slice
   {
-    while(Serial.peek() == -1);
-    return Serial.readStringUntil('\n');
+    size_t length   = 0;
+    bool   overflow = false;
+    char   ch;
+    while((ch = get_char()) != '\n')
+    {
+      if(length < line_buffer_size_ - 1)
+      {
+        line_buffer_[length++] = ch;
+      }
+      else
+      {
+        overflow = true;
+      }
+    }
+    if(overflow)
+    {
+      Log::error()(LogMessage::line_too_long);
+      length = 0;
+    }
+    line_buffer_[length] = '\0';
+    return string_slice(line_buffer_, line_buffer_ + length);
   }
 auto Control::peek_char() -> int
   {
     int ch;
-    while((ch = Serial.peek()) == -1) { yield(); }
+    while((ch = Serial.peek()) == -1) { service(); }
     return static_cast<unsigned char>(ch);
   }
 //============================================================================
 // errors and logging
 //============================================================================
-auto Control::error_expected_bool(const String& data) -> void
+auto Control::error_expected_bool(const string_slice& data) -> void
   {
     Log::error()("Expected a boolean value, but got: ", data);
   }
-auto Control::error_expected_int(const String& data) -> void
+auto Control::error_expected_int(const string_slice& data) -> void
   {
     Log::error()("Expected an integer, but got: ", data);
   }
+auto Control::error_parse(const rcode_t& rcode) -> void
+  {
+    switch(rcode.error())
+    {
+    case rcode_t::Error::expected_end_of_statement:
+      Log::error()("Error: expected ';' or end of line");
+      break;
+    case rcode_t::Error::expected_identifier:
+      Log::error()("Error: expected identifier");
+      break;
+    case rcode_t::Error::invalid_data:
+      Log::error()("Error: invalid data");
+      break;
+    default:
+      Log::error()("rcode invalid (bad subcommand)");
+    }
+  }
 //============================================================================
+// motion
 //============================================================================
-auto Control::run_command_processor() -> void
+// Keeps both axes moving; every wait loop calls this.
+auto Control::service() -> void
   {
-    // get and parse command line
-    auto cmdline = get_line();
-    Log::debug()("Received command line: \"", cmdline, "\"");
-    auto rcode = rcode_t::parse(cmdline); 
-    Log::debug()
-      ( "Parsed as:["
-      , rcode.name()
-      , "]["
-      , (int)rcode.command()
-      , "]["
-      , rcode.data()
-      , "]\n"
-      );
-    if(rcode.error() != rcode_t::Error::ok)
-    {
-      switch(rcode.error())
-      {
-      case rcode_t::Error::expected_end_of_line:
-        Log::error()("Error: expected end of line");
-        break;
-      case rcode_t::Error::expected_identifier:
-        Log::error()("Error: expected identifier");
-        break;
-      case rcode_t::Error::invalid_data:
-        Log::error()("Error: invalid data");
-        break;
-      default:
-        Log::error()("rcode invalid (bad subcommand)");
+    // never drive the carriage further into a limit switch that has closed
+    if((carriage_.direction() < 0 && limit_reached(limit_switch_min_))
+    || (carriage_.direction() > 0 && limit_reached(limit_switch_max_)))
+    {
+      carriage_.stop();
+    }
+    platform_.run();
+    carriage_.run();
+    yield();
+  }
+auto Control::apply_carriage_profile() -> void
+  {
+    using profile_t = decltype(carriage_)::Profile;
+    carriage_.set_profile(static_cast<profile_t>(config_.carriage_profile_), config_.carriage_accel_);
+  }
+auto Control::wait_for_motion() -> void
+  {
+    unsigned long last_output = millis();
+    while(platform_.is_moving() || carriage_.is_moving())
+    {
+      service();
+      if(millis() - last_output >= keep_alive_ms_)
+      {
+        Serial.println(keep_alive_line_);
+        last_output = millis();
       }
+    }
+  }
+//============================================================================
+// ranging and sample output
+//============================================================================
+// In continuous mode this returns the next measurement the sensor completes,
+// which may have started before the caller's last move; callers tag it with
+// the position at completion.
+auto Control::measure_range(VL53L0X_RangingMeasurementData_t& measure) -> void
+  {
+    if(ranging_continuous_ == false)
+    {
+      tof_sensor_.rangingTest(&measure, false);
       return;
     }
-    if(rcode.command() == rcode_t::Command::invalid)
+    while(tof_sensor_.isRangeComplete() == false)
     {
+      service();
     }
-    // search for requested function by name
-    const map_entry* fn_entry = nullptr;
-    for_each_function(
-      [&] (auto& f)
+    measure.RangeMilliMeter = tof_sensor_.readRange();
+    measure.RangeStatus     = tof_sensor_.readRangeStatus();
+  }
+// Take range_reads_ readings and reduce them to one sample.  Readings with a
+// failing status are thrown away; the rest are sorted and either the median
+// or the mean of the middle half is kept.  Confidence is the share of good
+// readings, scaled down as the middle half of them spreads out:
+//   255 * good / reads * 16 / (16 + spread_mm)
+// Everything is integer arithmetic on at most 15 readings.
+auto Control::measure_sample(RangeSample& sample) -> void
+  {
+    uint16_t  ranges[max_range_reads_];
+    int       good  = 0;
+    const int reads = config_.range_reads_;
+    VL53L0X_RangingMeasurementData_t measure;
+    for(int i = 0; i < reads; ++i)
+    {
+      measure_range(measure);
+      if(measure.RangeStatus == ScanFrame::status_ok_)
+      {
+        // insertion sort as the readings arrive
+        int j = good++;
+        for(; j > 0 && ranges[j - 1] > measure.RangeMilliMeter; --j)
         {
-          if(fn_entry == nullptr)
-          {
-            if(rcode.name() == f.name)
-            {
-              fn_entry = &f; 
-            }
-          }
+          ranges[j] = ranges[j - 1];
         }
-    );
+        ranges[j] = measure.RangeMilliMeter;
+      }
+    }
+    if(good == 0)
+    {
+      sample.range_mm   = measure.RangeMilliMeter;
+      sample.status     = measure.RangeStatus;
+      sample.confidence = 0;
+      return;
+    }
+    // [first, last) are averaged: the middle one or two, or the middle half
+    int first = (good - 1) / 2;
+    int last  = good / 2 + 1;
+    if(config_.range_filter_ == filter_trimmed_mean_)
+    {
+      first = good / 4;
+      last  = good - good / 4;
+    }
+    unsigned long sum = 0;
+    for(int k = first; k < last; ++k)
+    {
+      sum += ranges[k];
+    }
+    const unsigned long kept   = last - first;
+    const unsigned long spread = ranges[good - 1 - good / 4] - ranges[good / 4];
+    sample.range_mm   = (sum + kept / 2) / kept;
+    sample.status     = ScanFrame::status_ok_;
+    sample.confidence = 255UL * good / reads * 16 / (16 + spread);
+  }
+auto Control::set_ranging_continuous(bool enabled) -> void
+  {
+    if(enabled == ranging_continuous_)
+    {
+      return;
+    }
+    if(enabled)
+    {
+      ranging_continuous_ = tof_sensor_.startRangeContinuous(continuous_ranging_period_ms_);
+      if(ranging_continuous_ == false)
+      {
+        Log::error()("Could not start continuous ranging");
+      }
+    }
+    else
+    {
+      tof_sensor_.stopRangeContinuous();
+      ranging_continuous_ = false;
+    }
+  }
+auto Control::emit_sample(const RangeSample& sample) -> void
+  {
+    long platform_step = (platform_.position() - scan_origin_) % platform_.steps_per_revolution();
+    if(platform_step < 0)
+    {
+      platform_step += platform_.steps_per_revolution();
+    }
+    ScanFrame frame;
+    frame.sequence          = sample_sequence_++;
+    frame.platform_step     = platform_step;
+    frame.carriage_position = carriage_.position();
+    frame.range_mm          = sample.range_mm;
+    frame.status            = sample.status;
+    frame.confidence        = sample.confidence;
+    if(stream_binary_)
+    {
+      uint8_t bytes[ScanFrame::size_];
+      frame.encode(bytes);
+      Serial.write(bytes, sizeof(bytes));
+    }
+    else
+    {
+      Serial.print(frame.sequence);
+      Serial.print(' ');
+      Serial.print(frame.platform_step);
+      Serial.print(' ');
+      Serial.print(frame.carriage_position);
+      Serial.print(' ');
+      Serial.print(frame.range_mm);
+      Serial.print(' ');
+      Serial.print(frame.status);
+      Serial.print(' ');
+      Serial.println(frame.confidence);
+    }
+  }
+// one sample at each of resolution evenly spread platform positions
+// a span measured after scan.layers was set may be too short for it, so
+// the layers are capped at one per step
+auto Control::scan_layout() const -> ScanLayout
+  {
+    ScanLayout layout;
+    layout.layers       = config_.carriage_max_ > 0 && config_.scan_layers_ > config_.carriage_max_
+                        ? config_.carriage_max_
+                        : config_.scan_layers_;
+    layout.layer_steps  = config_.carriage_max_ / layout.layers > 0? config_.carriage_max_ / layout.layers : 1;
+    return layout;
+  }
+// starting at position first, with the platform already there
+auto Control::scan_layer_uniform(long resolution, long first) -> void
+  {
+    const long steps_per_revolution = platform_.steps_per_revolution();
+    RangeSample sample;
+    for(long i = first; i < resolution; ++i)
+    {
+      // a single-shot reading blocks the CPU, so finish the move first; in
+      // continuous mode the platform keeps moving while the sensor ranges
+      if(ranging_continuous_ == false)
+      {
+        wait_for_motion();
+      }
+      measure_sample(sample);
+      emit_sample(sample);
+      wait_for_motion();
+      // spread the steps evenly when resolution doesn't divide a revolution
+      auto steps = (i + 1) * steps_per_revolution / resolution 
+                 - i * steps_per_revolution / resolution;
+      platform_.move(steps);
+    }
+  }
+// Sample every scan_stride_th of the resolution positions, and go back to
+// fill in the positions skipped between two samples whose ranges differ by
+// more than scan_adaptive_mm_ (or where one of them is out of range).  Flat
+// stretches cost one reading per stride; edges keep full resolution.
+// Samples are emitted in the order taken, so backfilled ones arrive after
+// the sample that closed their gap.
+auto Control::scan_layer_adaptive(long resolution) -> void
+  {
+    const long steps_per_revolution = platform_.steps_per_revolution();
+    const long start  = platform_.position();
+    const long stride = config_.scan_stride_;
+    auto move_to = [&](long i)
+      {
+        wait_for_motion();
+        platform_.move(start + i * steps_per_revolution / resolution - platform_.position());
+        wait_for_motion();
+      };
+    auto sample = [&](long i, RangeSample& result)
+      {
+        move_to(i);
+        if(ranging_continuous_)
+        {
+          // the measurement in flight began before the move
+          VL53L0X_RangingMeasurementData_t stale;
+          measure_range(stale);
+        }
+        measure_sample(result);
+        emit_sample(result);
+      };
+    auto differ = [&](const RangeSample& a, const RangeSample& b)
+      {
+        if((a.status == ScanFrame::status_ok_) != (b.status == ScanFrame::status_ok_))
+        {
+          return true;
+        }
+        long delta = static_cast<long>(a.range_mm) - b.range_mm;
+        return delta > config_.scan_adaptive_mm_ || -delta > config_.scan_adaptive_mm_;
+      };
+    RangeSample first;
+    RangeSample previous;
+    RangeSample current;
+    sample(0, first);
+    previous = first;
+    for(long i = 0; i < resolution; )
+    {
+      // position resolution is position 0 of the next revolution, already
+      // measured
+      long next = i + stride < resolution? i + stride : resolution;
+      if(next < resolution)
+      {
+        sample(next, current);
+      }
+      else
+      {
+        current = first;
+      }
+      if(next - i > 1 && differ(previous, current))
+      {
+        for(long j = i + 1; j < next; ++j)
+        {
+          RangeSample fill;
+          sample(j, fill);
+        }
+      }
+      previous  = current;
+      i         = next;
+    }
+    // finish the revolution so every layer starts at the same angle
+    move_to(resolution);
+  }
+//============================================================================
+//============================================================================
+// A line may batch several ';'-separated statements; they run in order, and
+// a statement that does not parse drops the rest of the line.
+auto Control::run_command_processor() -> void
+  {
+    auto cmdline = get_line();
+    Log::debug()("Received command line: \"", cmdline, "\"");
+    for_each_statement(cmdline, [this](const rcode_t& rcode) { execute(rcode); });
+  }
+auto Control::execute(const rcode_t& rcode) -> void
+  {
+    // look up requested function by name
+    const map_entry* fn_entry = find_function(rcode.name().begin(), rcode.name().length());
     auto command_not_found = fn_entry == nullptr;
     if(command_not_found)
     {
@@ -311,19 +728,19 @@ auto Control::set_standby_all(pin_value_t pv) -> void
 //============================================================================
 // "rc" functions
 //============================================================================
+auto Control::rc_carriage_accel(const rcode_t& rc) -> void
+  {
+    rc_int_value(rc, config_.carriage_accel_, 200, 30000);
+    apply_carriage_profile();
+  }
 auto Control::rc_carriage_move_steps(const rcode_t& rc) -> void
   {
-    auto result = data_to_int(rc.data());
+    auto result = data_to_int(rc);
     if(result.first == true)
     {
       const auto& steps = result.second;
-      Log::info()("Moving carriage ", steps, " steps");
-      auto_standby(carriage_, [&]
-        {
-          carriage_.set_speed(config_.carriage_speed_);
-          carriage_.step(steps);
-        }
-      );
+      Log::info()(LogMessage::moving_carriage, steps);
+      start_move(carriage_, steps, config_.carriage_speed_);
     }
     else
     {
@@ -331,6 +748,26 @@ auto Control::rc_carriage_move_steps(const rcode_t& rc) -> void
       halt();
     }
   }
+auto Control::rc_carriage_home_speed(const rcode_t& rc) -> void
+  {
+    rc_int_value(rc, config_.carriage_home_speed_, 1, 1000);
+  }
+// the span found by carriage.auto_set_span; a value set here is trusted
+// like a measured one, so it can be corrected before config.save
+auto Control::rc_carriage_max(const rcode_t& rc) -> void
+  {
+    const long travel = static_cast<long>(screw_max_turns_) * carriage_.steps_per_revolution();
+    rc_int_value(rc, config_.carriage_max_, 1, travel < INT_MAX? static_cast<int>(travel) : INT_MAX);
+    if(rc.command() == rcode_t::Command::set && data_to_int(rc).second == config_.carriage_max_)
+    {
+      span_known_ = true;
+    }
+  }
+auto Control::rc_carriage_profile(const rcode_t& rc) -> void
+  {
+    rc_int_value(rc, config_.carriage_profile_, 0, 2);
+    apply_carriage_profile();
+  }
 auto Control::rc_carriage_set_home(const rcode_t& rc) -> void
   {
     auto_set_home();
@@ -339,7 +776,77 @@ auto Control::rc_carriage_set_span(const rcode_t& rc) -> void
   {
     auto_set_home();
     auto_set_max();
-    Log::info()("carriage_max_ == ", config_.carriage_max_);
+    Log::info()(LogMessage::carriage_max, config_.carriage_max_);
+  }
+auto Control::rc_carriage_seek_speed(const rcode_t& rc) -> void
+  {
+    rc_int_value(rc, config_.carriage_seek_speed_, 1, 1000);
+  }
+auto Control::rc_carriage_seek_steps(const rcode_t& rc) -> void
+  {
+    rc_int_value(rc, config_.carriage_seek_steps_, 1, 1000);
+  }
+auto Control::rc_carriage_speed(const rcode_t& rc) -> void
+  {
+    rc_int_value(rc, config_.carriage_speed_, 1, 1000);
+  }
+auto Control::rc_config_defaults(const rcode_t& rc) -> void
+  {
+    config_     = Config();
+    span_known_ = false;
+    apply_config();
+    Log::info()("Configuration reset to defaults.");
+  }
+auto Control::rc_config_load(const rcode_t& rc) -> void
+  {
+    if(load_config() == false)
+    {
+      Log::error()("No valid stored configuration.");
+      return;
+    }
+    apply_config();
+    Log::info()("Stored configuration loaded.");
+  }
+auto Control::rc_config_save(const rcode_t& rc) -> void
+  {
+    StoredConfig record;
+    record.config           = config_;
+    record.span_known       = span_known_? 1 : 0;
+    record.parked_position  = -1;
+    write_stored_config(record);
+    Log::info()("Configuration saved.");
+  }
+// catalogued log messages as binary records (see log_record.hpp)
+auto Control::rc_log_binary(const rcode_t& rc) -> void
+  {
+    auto do_get_mode = [&]
+      {
+        Serial.println(Log::binary()? 1 : 0);
+      };
+    auto do_set_mode = [&]
+      {
+        auto result = data_to_bool(rc);
+        if(result.first == true)
+        {
+          Log::binary() = result.second;
+        }
+        else
+        {
+          error_expected_bool(rc.data());
+        }
+      };
+    switch(rc.command())
+    {
+    case rcode_t::Command::get:
+      do_get_mode();
+      break;
+    case rcode_t::Command::set:
+      do_set_mode(); 
+      do_get_mode(); 
+      break;
+    default:
+      Log::error()("Invalid subcommand");
+    }
   }
 auto Control::rc_log_info(const rcode_t& rc) -> void
   {
@@ -349,6 +856,11 @@ auto Control::rc_log_info(const rcode_t& rc) -> void
         {
           constexpr bool enabled = true;
           const char* state_string = requested_state == enabled? "enabled" : "disabled";
+          if(logger.compiled_in_ == false)
+          {
+            Log::warning()("\"", lname, "\" messages are compiled out; see LOG_LEVEL.");
+            return;
+          }
           logger.set_enabled(requested_state);
           Log::info()("Logging ", state_string, " for \"", lname, "\" messages.");
         };
@@ -364,7 +876,7 @@ auto Control::rc_log_info(const rcode_t& rc) -> void
       return;
     }
     auto logger_name = rc.name().substring(last_dot + 1); 
-    auto result = data_to_bool(rc.data());
+    auto result = data_to_bool(rc);
     if(result.first == true)
     {
       const auto& requested_state = result.second;
@@ -375,24 +887,115 @@ auto Control::rc_log_info(const rcode_t& rc) -> void
       error_expected_bool(rc.data());
     }
   }
+// A macro is a stored batch of statements, e.g.
+//
+//   macro.define="platform.move.steps=1;motion.wait;rangefinder.ping"
+//   macro.run=200
+//
+// Statements are checked when stored, so a run never stops on a bad one.
+auto Control::macro_valid(const string_slice& statements) -> bool
+  {
+    bool valid = true;
+    auto check = [&](const rcode_t& rcode)
+      {
+        if(find_function(rcode.name().begin(), rcode.name().length()) == nullptr)
+        {
+          Log::error()("Unknown command in macro: ", rcode.name());
+          valid = false;
+        }
+        else if(rcode.name() == "macro.run")
+        {
+          Log::error()("A macro cannot run a macro.");
+          valid = false;
+        }
+      };
+    return for_each_statement(statements, check) && valid;
+  }
+auto Control::macro_store(const string_slice& statements, bool append) -> void
+  {
+    size_t start = append && macro_length_ != 0? macro_length_ + 1 : 0;
+    if(start + statements.length() >= macro_buffer_size_)
+    {
+      Log::error()("Macro too long; at most ", macro_buffer_size_ - 1, " characters.");
+      return;
+    }
+    if(macro_valid(statements) == false)
+    {
+      return;
+    }
+    if(start != 0)
+    {
+      macro_buffer_[macro_length_] = ';';
+    }
+    memcpy(macro_buffer_ + start, statements.begin(), statements.length());
+    macro_length_ = start + statements.length();
+    macro_buffer_[macro_length_] = '\0';
+  }
+auto Control::rc_macro_append(const rcode_t& rc) -> void
+  {
+    if(rc.command() != rcode_t::Command::set)
+    {
+      Log::error()("Expected a quoted list of statements.");
+      return;
+    }
+    macro_store(rc.data(), true);
+  }
+auto Control::rc_macro_define(const rcode_t& rc) -> void
+  {
+    if(rc.command() == rcode_t::Command::set)
+    {
+      macro_store(rc.data(), false);
+    }
+    Serial.println(string_slice(macro_buffer_, macro_buffer_ + macro_length_));
+  }
+// macro.run runs the macro once, macro.run=N N times
+auto Control::rc_macro_run(const rcode_t& rc) -> void
+  {
+    int count = 1;
+    if(rc.command() == rcode_t::Command::set)
+    {
+      auto result = data_to_int(rc);
+      if(result.first == false || result.second < 0)
+      {
+        error_expected_int(rc.data());
+        return;
+      }
+      count = result.second;
+    }
+    if(macro_running_)
+    {
+      Log::error()("A macro cannot run a macro.");
+      return;
+    }
+    macro_running_ = true;
+    const auto body = string_slice(macro_buffer_, macro_buffer_ + macro_length_);
+    for(int i = 0; i < count; ++i)
+    {
+      for_each_statement(body, [this](const rcode_t& rcode) { execute(rcode); });
+    }
+    macro_running_ = false;
+  }
+auto Control::rc_motion_busy(const rcode_t& rc) -> void
+  {
+    Serial.println(platform_.is_moving() || carriage_.is_moving()? 1 : 0);
+  }
+auto Control::rc_motion_stop(const rcode_t& rc) -> void
+  {
+    platform_.stop();
+    carriage_.stop();
+  }
+auto Control::rc_motion_wait(const rcode_t& rc) -> void
+  {
+    wait_for_motion();
+  }
 auto Control::rc_platform_move_steps(const rcode_t& rc) -> void
   {
-    auto result = data_to_int(rc.data());
+    auto result = data_to_int(rc);
     if(result.first == true)
     {
       const auto& steps = result.second;
-      Log::info()("Moving platform ", steps, " steps");
-      platform_.resume();
-      platform_.set_speed(config_.platform_speed_);
-      platform_.step(steps);
-      platform_.standby();
-
-//      auto_standby(platform_, [&]
-//        {
-//          platform_.set_speed(config_.platform_speed_);
-//          platform_.step(steps);
-//        }
-//      );
+      Log::info()(LogMessage::moving_platform, steps);
+      start_move(platform_, steps, config_.platform_speed_);
     }
     else
     {
@@ -402,45 +1005,241 @@ auto Control::rc_platform_move_steps(const rcode_t& rc) -> void
   }
 auto Control::rc_platform_speed(const rcode_t& rc) -> void
   {
-    auto do_get_speed = [&]
+    rc_int_value(rc, config_.platform_speed_, 1, 1000);
+  }
+auto Control::rc_rangefinder_continuous(const rcode_t& rc) -> void
+  {
+    switch(rc.command())
+    {
+    case rcode_t::Command::get:
+      Serial.println(ranging_continuous_? 1 : 0);
+      break;
+    case rcode_t::Command::set:
+      {
+        auto result = data_to_bool(rc);
+        if(result.first == true)
+        {
+          set_ranging_continuous(result.second);
+        }
+        else
+        {
+          error_expected_bool(rc.data());
+        }
+        Serial.println(ranging_continuous_? 1 : 0);
+      }
+      break;
+    default:
+      Log::error()("Invalid subcommand");
+    }
+  }
+auto Control::rc_rangefinder_filter(const rcode_t& rc) -> void
+  {
+    rc_int_value(rc, config_.range_filter_, filter_median_, filter_trimmed_mean_);
+  }
+auto Control::rc_rangefinder_ping(const rcode_t& rc) -> void
+  {
+    RangeSample sample;
+    Log::debug()(LogMessage::range_measurement);
+    // a ping is a sequence point: measure where the last move ended up
+    wait_for_motion();
+    measure_sample(sample);
+    if(stream_binary_)
+    {
+      // the status travels in the frame; let the host decide what to drop
+      emit_sample(sample);
+    }
+    else if (sample.status == ScanFrame::status_ok_) {
+      Serial.println(sample.range_mm);
+    } else {
+      Log::info()(LogMessage::out_of_range);
+    }
+  }
+auto Control::rc_rangefinder_reads(const rcode_t& rc) -> void
+  {
+    rc_int_value(rc, config_.range_reads_, 1, max_range_reads_);
+  }
+auto Control::rc_scan_adaptive(const rcode_t& rc) -> void
+  {
+    rc_int_value(rc, config_.scan_adaptive_mm_, 0, 1000);
+  }
+// only positions the scan reaches, which are below carriage_max_ unless
+// that divides evenly into the layers
+auto Control::rc_scan_after_carriage(const rcode_t& rc) -> void
+  {
+    rc_int_value(rc, scan_after_carriage_, -1, scan_layout().last_carriage());
+  }
+auto Control::rc_scan_after_step(const rcode_t& rc) -> void
+  {
+    rc_int_value(rc, scan_after_step_, 0, platform_.steps_per_revolution() - 1);
+  }
+// read only; a host resuming a scan checks the layers still line up
+auto Control::rc_scan_layer_steps(const rcode_t& rc) -> void
+  {
+    Serial.println(scan_layout().layer_steps);
+  }
+auto Control::rc_scan_layers(const rcode_t& rc) -> void
+  {
+    // every layer needs a step of its own within the span
+    rc_int_value(rc, config_.scan_layers_, 1, config_.carriage_max_ > 1? config_.carriage_max_ : 1);
+  }
+auto Control::rc_scan_resolution(const rcode_t& rc) -> void
+  {
+    rc_int_value(rc, config_.scan_resolution_, 1, platform_.steps_per_revolution());
+  }
+// Resuming (scan.after_carriage >= 0) assumes the board was reset since the
+// scan stopped: the carriage has homed again, and the platform, which has no
+// home switch, is taken to be at the angle of the last sample sent.  A reset
+// part way through the following move leaves it at most one sample further.
+auto Control::rc_scan_run(const rcode_t& rc) -> void
+  {
+    const long resolution           = config_.scan_resolution_;
+    const auto layout               = scan_layout();
+    const int  layers               = layout.layers;
+    const int  layer_steps          = layout.layer_steps;
+    if(layers != config_.scan_layers_)
+    {
+      Log::warning()(LogMessage::value_out_of_range, 1, config_.carriage_max_, config_.scan_layers_);
+    }
+    // the span may have changed since scan.after_carriage was set
+    if(scan_after_carriage_ > layout.last_carriage())
+    {
+      Log::error()(LogMessage::value_out_of_range, -1, layout.last_carriage(), scan_after_carriage_);
+      scan_after_carriage_ = -1;
+      return;
+    }
+    const long steps_per_revolution = platform_.steps_per_revolution();
+    auto sample_step = [&](long i)
+      {
+        return i * steps_per_revolution / resolution;
+      };
+    int  first_layer  = 0;
+    long first_sample = 0;
+    long platform_to  = 0;  // steps to the first sample
+    // let a move from an earlier command finish before taking positions
+    wait_for_motion();
+    scan_origin_      = platform_.position();
+    if(scan_after_carriage_ >= 0)
+    {
+      scan_origin_  = platform_.position() - scan_after_step_;
+      first_layer   = scan_after_carriage_ / layer_steps;
+      // an adaptive layer's samples are not in platform order, so an
+      // interrupted one is scanned again
+      if(config_.scan_adaptive_mm_ == 0)
+      {
+        while(first_sample < resolution && sample_step(first_sample) <= scan_after_step_)
+        {
+          ++first_sample;
+        }
+      }
+      if(first_sample == resolution)
+      {
+        ++first_layer;
+        first_sample = 0;
+      }
+      platform_to = sample_step(first_sample) - scan_after_step_;
+      if(platform_to < 0)
+      {
+        platform_to += steps_per_revolution;
+      }
+      Log::info()(LogMessage::resuming_scan, first_layer, first_sample);
+    }
+    scan_after_carriage_ = -1;
+    Serial.println("#scan.begin");
+    platform_.set_speed(config_.platform_speed_);
+    carriage_.set_speed(config_.carriage_speed_);
+    resume_all();
+    // layers are measured up from home
+    wait_for_motion();
+    const long carriage_to = static_cast<long>(first_layer) * layer_steps - carriage_.position();
+    carriage_.move(carriage_to);
+    platform_.move(platform_to);
+    wait_for_motion();
+    if(ranging_continuous_ && (carriage_to != 0 || platform_to != 0))
+    {
+      // the measurement in flight was taken on the way to the first sample
+      VL53L0X_RangingMeasurementData_t stale;
+      measure_range(stale);
+    }
+    for(int layer = first_layer; layer < layers; ++layer)
+    {
+      Log::debug()(LogMessage::scanning_layer, layer);
+      VL53L0X_RangingMeasurementData_t measure;
+      if(layer > first_layer)
+      {
+        carriage_.move(layer_steps);
+        wait_for_motion();
+        if(ranging_continuous_)
+        {
+          // the measurement in flight straddles the layer change
+          measure_range(measure);
+        }
+      }
+      if(config_.scan_adaptive_mm_ > 0)
+      {
+        scan_layer_adaptive(resolution);
+      }
+      else
+      {
+        scan_layer_uniform(resolution, layer == first_layer? first_sample : 0);
+      }
+      wait_for_motion();
+    }
+    carriage_.move(-carriage_.position());
+    wait_for_motion();
+    standby_all();
+    Serial.println("#scan.end");
+  }
+auto Control::rc_scan_stride(const rcode_t& rc) -> void
+  {
+    rc_int_value(rc, config_.scan_stride_, 1, platform_.steps_per_revolution());
+  }
+auto Control::rc_stream_binary(const rcode_t& rc) -> void
+  {
+    auto do_get_mode = [&]
       {
-        Serial.println(config_.platform_speed_);
+        Serial.println(stream_binary_? 1 : 0);
       };
-    auto do_set_speed = [&]
+    auto do_set_mode = [&]
       {
-        auto result = data_to_int(rc.data());
+        auto result = data_to_bool(rc);
         if(result.first == true)
         {
-          config_.platform_speed_ = result.second;
+          stream_binary_    = result.second;
+          sample_sequence_  = 0;
         }
         else
         {
-          Log::error()("Could not set speed; argument conversion error.");
+          error_expected_bool(rc.data());
         }
       };
     switch(rc.command())
     {
     case rcode_t::Command::get:
-      do_get_speed();
+      do_get_mode();
       break;
     case rcode_t::Command::set:
-      do_set_speed(); 
-      do_get_speed(); 
+      do_set_mode(); 
+      do_get_mode(); 
       break;
     default:
       Log::error()("Invalid subcommand");
     }
   }
-auto Control::rc_rangefinder_ping(const rcode_t& rc) -> void
+// sequence number of the next sample; a resumed scan carries on from the
+// last one the client kept (stream.binary=1 restarts it at 0)
+auto Control::rc_stream_sequence(const rcode_t& rc) -> void
   {
-    VL53L0X_RangingMeasurementData_t measure;
-    Log::info()("Single range measurement");
-    tof_sensor_.rangingTest(&measure, false);
-    if (measure.RangeStatus != 4) {  // phase failures have incorrect data
-      Serial.println(measure.RangeMilliMeter);
-    } else {
-      Log::info()("Out of range ");
+    if(rc.command() == rcode_t::Command::set)
+    {
+      auto result = data_to_long(rc);
+      if(result.first == false || result.second < 0 || result.second > 65535)
+      {
+        error_expected_int(rc.data());
+        return;
+      }
+      sample_sequence_ = static_cast<uint16_t>(result.second);
     }
+    Serial.println(sample_sequence_);
   }
 auto Control::rc_reboot(const rcode_t& rc) -> void
   {
@@ -455,6 +1254,89 @@ auto Control::rc_system_poll(const rcode_t& rc) -> void
         }
     );
   }
+// Switch the serial link to another rate.  The confirmation goes out at the
+// old rate and everything after it, starting with READY, at the new one;
+// the host switches its end when it reads the confirmation.
+auto Control::rc_system_baud(const rcode_t& rc) -> void
+  {
+    if(rc.command() == rcode_t::Command::get)
+    {
+      Serial.println(baud_);
+      return;
+    }
+    auto result = data_to_long(rc);
+    bool supported = false;
+    for(auto rate : baud_rates_)
+    {
+      supported = supported || (result.first && result.second == rate);
+    }
+    if(supported == false)
+    {
+      Log::error()("Unsupported baud rate: ", rc.data());
+      return;
+    }
+    Serial.print("#baud ");
+    Serial.println(result.second);
+    Serial.flush();
+    delay(baud_switch_delay_ms_);
+    Serial.end();
+    baud_ = result.second;
+    Serial.begin(baud_);
+  }
+// receive buffer size, so the host knows how much it may send ahead
+auto Control::rc_system_rx_buffer(const rcode_t& rc) -> void
+  {
+    Serial.println(SERIAL_RX_BUFFER_SIZE);
+  }
+// echo a host-chosen token so a client can find the start of its own
+// responses in whatever the port held before it connected
+auto Control::rc_system_sync(const rcode_t& rc) -> void
+  {
+    auto result = data_to_int(rc);
+    if(rc.command() != rcode_t::Command::set || result.first == false)
+    {
+      error_expected_int(rc.data());
+      return;
+    }
+    Serial.print("#sync ");
+    Serial.println(result.second);
+  }
+// get or set an integer value, rejecting anything outside [min, max]
+auto Control::rc_int_value(const rcode_t& rc, int& value, int min_value, int max_value) -> void
+  {
+    auto do_get_value = [&]
+      {
+        Serial.println(value);
+      };
+    auto do_set_value = [&]
+      {
+        auto result = data_to_int(rc);
+        if(result.first == false)
+        {
+          Log::error()("Could not set value; argument conversion error.");
+        }
+        else if(result.second < min_value || result.second > max_value)
+        {
+          Log::error()(LogMessage::value_out_of_range, min_value, max_value, result.second);
+        }
+        else
+        {
+          value = result.second;
+        }
+      };
+    switch(rc.command())
+    {
+    case rcode_t::Command::get:
+      do_get_value();
+      break;
+    case rcode_t::Command::set:
+      do_set_value(); 
+      do_get_value(); 
+      break;
+    default:
+      Log::error()("Invalid subcommand");
+    }
+  }
 //============================================================================
 // "test" functions
 //============================================================================
@@ -28,6 +28,9 @@ SOFTWARE.
 #include "fake_pair.hpp"
 #include "stepper_control.hpp"
 #include "rcode.hpp"
+#include "rcode_dispatch.hpp"
+#include "scan_frame.hpp"
+#include "string_slice.hpp"
 
 
 class Control
@@ -44,7 +47,7 @@ public:
 
 private:
   using pin_value_t   = decltype(HIGH);
-  using rcode_t       = RCode<String>;
+  using rcode_t       = RCode<string_slice>;
   enum class SeekOrientation { Forward, Reverse };
 
   StepperControl<Stepper, 200, 2, 3, 4, 5, 23> platform_;
@@ -58,27 +61,144 @@ private:
   struct Config 
   {
     int carriage_speed_       = 200;
-    int carriage_seek_speed_  = 100;
-    int carriage_seek_steps_  = 15;
+    int carriage_home_speed_  = 300;  // rpm, homing approach
+    int carriage_seek_speed_  = 40;   // rpm, final approach to a limit switch
+    int carriage_seek_steps_  = 15;   // back-off between the two approaches
     int platform_speed_       = 100;
     int carriage_max_         = 229;
+    int carriage_accel_       = 2000; // steps/s^2
+    int carriage_profile_     = 0;    // 0 constant, 1 trapezoid, 2 S-curve
+    int scan_resolution_      = 200;  // samples per platform revolution
+    int scan_layers_          = 10;   // carriage layers, spread over carriage_max_
+    int range_reads_          = 1;    // readings filtered into each sample
+    int range_filter_         = 0;    // filter_median or filter_trimmed_mean
+    int scan_adaptive_mm_     = 0;    // refine where range jumps by more; 0 off
+    int scan_stride_          = 8;    // samples skipped between coarse samples
   } config_;
 
-  int carriage_position_ = 0;
+  // Config as kept in EEPROM by config.save
+  struct StoredConfig
+  {
+    uint16_t  version;
+    uint16_t  size;             // sizeof(StoredConfig), catches layout changes
+    Config    config;
+    uint8_t   span_known;       // config.carriage_max_ was measured
+    long      parked_position;  // carriage position at reboot, or -1
+    uint16_t  crc;              // CRC-16/CCITT over the fields above
+  };
+
+  static constexpr int filter_median_        = 0;
+  static constexpr int filter_trimmed_mean_  = 1;
+  static constexpr int max_range_reads_      = 15;
+
+  // one output sample: the filtered value of range_reads_ readings
+  struct RangeSample
+  {
+    uint16_t  range_mm    = 0;
+    uint8_t   status      = 0;
+    uint8_t   confidence  = 0;  // 0-255
+  };
+
+  // the layers scan.run takes, and the carriage steps between them
+  struct ScanLayout
+  {
+    int layers      = 1;
+    int layer_steps = 1;
+    auto last_carriage() const -> int { return (layers - 1) * layer_steps; }
+  };
+
+  // sample output; binary frames (see scan_frame.hpp) or text lines
+  bool      stream_binary_    = false;
+  uint16_t  sample_sequence_  = 0;
+  // platform_ position at the start of the scan; frames count steps from it
+  long      scan_origin_      = 0;
+  // the next scan.run resumes an interrupted scan after the sample sent at
+  // this carriage position and platform step; -1 scans from the start
+  int       scan_after_carriage_  = -1;
+  int       scan_after_step_      = 0;
+  // carriage_ position and carriage_max_ were found by homing since boot
+  bool      home_known_       = false;
+  bool      span_known_       = false;
+  // back-to-back ranging; the sensor measures while the motors move
+  bool      ranging_continuous_ = false;
+
+  // serial link rate; begin() starts at the default, system.baud changes it
+  long      baud_             = 0;
+
+  // every command line is read into this buffer and parsed in place
+  static constexpr size_t line_buffer_size_ = 128;
+  char line_buffer_[line_buffer_size_];
+  // statements stored by macro.define/macro.append and replayed by macro.run
+  static constexpr size_t macro_buffer_size_ = 128;
+  char      macro_buffer_[macro_buffer_size_];
+  size_t    macro_length_     = 0;
+  bool      macro_running_    = false;
 
   // text processing;
   // probably should be moved out to another class, but whatev, it's easier to 
   // halt on errors this way (and Arduino is hamstrung w/o stdlib)
-  auto data_to_bool(const String& d) -> pair<bool, bool>;
-  auto data_to_int(const String& d) -> pair<bool, int>;
+  auto data_to_bool(const rcode_t& rc) -> pair<bool, bool>;
+  auto data_to_int(const rcode_t& rc) -> pair<bool, int>;
+  auto data_to_long(const rcode_t& rc) -> pair<bool, long>;
   auto get_char() -> char;
-  auto get_line() -> String;
+  auto get_line() -> string_slice;
   auto is_valid_for_int(int ch) -> bool;
   auto peek_char() -> int;
   // errors and logging
   auto error(const String& msg)                   -> void;
-  auto error_expected_bool(const String& data)    -> void; 
-  auto error_expected_int(const String& data)     -> void;
+  auto error_expected_bool(const string_slice& data)  -> void; 
+  auto error_expected_int(const string_slice& data)   -> void;
+  auto error_parse(const rcode_t&)                    -> void;
+  // command execution
+  auto execute(const rcode_t&) -> void;
+  auto macro_store(const string_slice& statements, bool append) -> void;
+  auto macro_valid(const string_slice& statements) -> bool;
+  // calls f for each statement of a ';'-separated line; stops at the first
+  // that does not parse, returning false
+template<typename F>
+  auto for_each_statement(const string_slice& line, F&& f) -> bool
+    {
+      auto lexer = rcode_t::lexer_t(line);
+      while(lexer.at_end() == false)
+      {
+        auto rcode = rcode_t::parse(lexer);
+        Log::debug()
+          ( "Parsed as:["
+          , rcode.name()
+          , "]["
+          , (int)rcode.command()
+          , "]["
+          , rcode.data()
+          , "]\n"
+          );
+        if(rcode.error() != rcode_t::Error::ok)
+        {
+          error_parse(rcode);
+          return false;
+        }
+        if(rcode.name().length() != 0)
+        {
+          f(rcode);
+        }
+      }
+      return true;
+    }
+  // ranging and sample output
+  auto measure_range(VL53L0X_RangingMeasurementData_t&) -> void;
+  auto measure_sample(RangeSample&) -> void;
+  auto set_ranging_continuous(bool enabled) -> void;
+  auto emit_sample(const RangeSample&) -> void;
+  // one platform revolution of a scan layer
+  auto scan_layout() const -> ScanLayout;
+  auto scan_layer_uniform(long resolution, long first) -> void;
+  auto scan_layer_adaptive(long resolution) -> void;
+
+  // configuration kept in EEPROM
+  auto apply_config() -> void;
+  auto load_config() -> bool;
+  auto read_stored_config(StoredConfig&) -> bool;
+  auto write_stored_config(StoredConfig&) -> void;
+  auto store_parked_position(long position) -> void;
 
   auto auto_set_max()  -> seek_count_t;
   auto auto_set_home() -> seek_count_t;
@@ -87,33 +207,75 @@ private:
   auto limit_reached(int pin) -> bool;
   auto reboot() -> void;
   auto resume_all() -> void;
-  auto seek_limit(int limit_pin, SeekOrientation o) -> seek_count_t;
+  auto seek_limit(int limit_pin, SeekOrientation o, long expected_steps) -> seek_count_t;
   auto set_standby_all(pin_value_t) -> void;
   auto standby_all() -> void;
 
   // rc functions
+  auto rc_carriage_accel(const rcode_t&)          -> void;
   auto rc_carriage_move_steps(const rcode_t&)     -> void;
+  auto rc_carriage_home_speed(const rcode_t&)     -> void;
+  auto rc_carriage_max(const rcode_t&)            -> void;
+  auto rc_carriage_profile(const rcode_t&)        -> void;
+  auto rc_carriage_seek_speed(const rcode_t&)     -> void;
+  auto rc_carriage_seek_steps(const rcode_t&)     -> void;
   auto rc_carriage_set_home(const rcode_t&)       -> void;
   auto rc_carriage_set_span(const rcode_t&)       -> void;
+  auto rc_carriage_speed(const rcode_t&)          -> void;
+  auto rc_config_defaults(const rcode_t&)         -> void;
+  auto rc_config_load(const rcode_t&)             -> void;
+  auto rc_config_save(const rcode_t&)             -> void;
+  auto rc_log_binary(const rcode_t&)              -> void;
   auto rc_log_info(const rcode_t& rc)             -> void;
+  auto rc_macro_append(const rcode_t&)            -> void;
+  auto rc_macro_define(const rcode_t&)            -> void;
+  auto rc_macro_run(const rcode_t&)               -> void;
+  auto rc_motion_busy(const rcode_t& rc)          -> void;
+  auto rc_motion_stop(const rcode_t& rc)          -> void;
+  auto rc_motion_wait(const rcode_t& rc)          -> void;
   auto rc_platform_move_steps(const rcode_t& rc)  -> void;
   auto rc_platform_speed(const rcode_t& rc)       -> void;
+  auto rc_rangefinder_continuous(const rcode_t&)  -> void;
+  auto rc_rangefinder_filter(const rcode_t& rc)   -> void;
   auto rc_rangefinder_ping(const rcode_t&)        -> void;
+  auto rc_rangefinder_reads(const rcode_t& rc)    -> void;
+  // rc scan and sample stream functions
+  auto rc_scan_adaptive(const rcode_t& rc)        -> void;
+  auto rc_scan_after_carriage(const rcode_t& rc)  -> void;
+  auto rc_scan_after_step(const rcode_t& rc)      -> void;
+  auto rc_scan_layer_steps(const rcode_t&)        -> void;
+  auto rc_scan_layers(const rcode_t& rc)          -> void;
+  auto rc_scan_resolution(const rcode_t& rc)      -> void;
+  auto rc_scan_run(const rcode_t& rc)             -> void;
+  auto rc_scan_stride(const rcode_t& rc)          -> void;
+  auto rc_stream_binary(const rcode_t& rc)        -> void;
+  auto rc_stream_sequence(const rcode_t& rc)      -> void;
   // rc system functions
   auto rc_reboot(const rcode_t& rc)               -> void;
+  auto rc_system_baud(const rcode_t&)                  -> void;
   auto rc_system_poll(const rcode_t& rc)               -> void;
+  auto rc_system_rx_buffer(const rcode_t&)             -> void;
+  auto rc_system_sync(const rcode_t& rc)               -> void;
+  // rc helpers
+  auto rc_int_value(const rcode_t& rc, int& value, int min_value, int max_value) -> void;
 
   // test functions
   auto test_limit_switches() -> void;
 
-  // function to automatically enable/disable stepper before/after movement,
-  // respectively
-template<typename StepperT, typename FnT>
-  auto auto_standby(StepperT& stepper, FnT&& in_between_fn) -> void
+  // motion
+  auto service() -> void;
+  // prints keep_alive_line_ while a wait runs long, so the host can tell
+  // a slow move from a hung scanner
+  auto wait_for_motion() -> void;
+  auto apply_carriage_profile() -> void;
+  // start a non-blocking move that releases the stepper when it completes
+template<typename StepperT>
+  auto start_move(StepperT& stepper, long steps, int speed) -> void
     {
+      stepper.set_speed(speed);
       stepper.resume();
-      in_between_fn();
-      stepper.standby();
+      stepper.move(steps);
+      stepper.release_when_idle();
     }
 
   // structure for mapping rcodes to member functions
@@ -124,25 +286,67 @@ template<typename StepperT, typename FnT>
     callback_t  callback;
   };
   // array of rcode mapping
+  static constexpr map_entry rcode_map_[] =
+    {
+      map_entry { "carriage.accel"          , &Control::rc_carriage_accel       },
+      map_entry { "carriage.move.steps"     , &Control::rc_carriage_move_steps  },
+      map_entry { "carriage.auto_set_home"  , &Control::rc_carriage_set_home    },
+      map_entry { "carriage.auto_set_span"  , &Control::rc_carriage_set_span    },
+      map_entry { "carriage.home_speed"     , &Control::rc_carriage_home_speed  },
+      map_entry { "carriage.max"            , &Control::rc_carriage_max         },
+      map_entry { "carriage.profile"        , &Control::rc_carriage_profile     },
+      map_entry { "carriage.seek_speed"     , &Control::rc_carriage_seek_speed  },
+      map_entry { "carriage.seek_steps"     , &Control::rc_carriage_seek_steps  },
+      map_entry { "carriage.speed"          , &Control::rc_carriage_speed       },
+      map_entry { "config.defaults"         , &Control::rc_config_defaults      },
+      map_entry { "config.load"             , &Control::rc_config_load          },
+      map_entry { "config.save"             , &Control::rc_config_save          },
+      map_entry { "log.binary"              , &Control::rc_log_binary           },
+      map_entry { "log.debug"               , &Control::rc_log_info             },
+      map_entry { "log.error"               , &Control::rc_log_info             },
+      map_entry { "log.info"                , &Control::rc_log_info             },
+      map_entry { "log.warning"             , &Control::rc_log_info             },
+      map_entry { "macro.append"            , &Control::rc_macro_append         },
+      map_entry { "macro.define"            , &Control::rc_macro_define         },
+      map_entry { "macro.run"               , &Control::rc_macro_run            },
+      map_entry { "motion.busy"             , &Control::rc_motion_busy          },
+      map_entry { "motion.stop"             , &Control::rc_motion_stop          },
+      map_entry { "motion.wait"             , &Control::rc_motion_wait          },
+      map_entry { "platform.move.steps"     , &Control::rc_platform_move_steps  },
+      map_entry { "platform.speed"          , &Control::rc_platform_speed       },
+      map_entry { "rangefinder.continuous"  , &Control::rc_rangefinder_continuous },
+      map_entry { "rangefinder.filter"      , &Control::rc_rangefinder_filter   },
+      map_entry { "rangefinder.ping"        , &Control::rc_rangefinder_ping     },
+      map_entry { "rangefinder.reads"       , &Control::rc_rangefinder_reads    },
+      map_entry { "reboot"                  , &Control::rc_reboot               },
+      map_entry { "scan.adaptive"           , &Control::rc_scan_adaptive        },
+      map_entry { "scan.after_carriage"     , &Control::rc_scan_after_carriage  },
+      map_entry { "scan.after_step"         , &Control::rc_scan_after_step      },
+      map_entry { "scan.layer_steps"        , &Control::rc_scan_layer_steps     },
+      map_entry { "scan.layers"             , &Control::rc_scan_layers          },
+      map_entry { "scan.resolution"         , &Control::rc_scan_resolution      },
+      map_entry { "scan.run"                , &Control::rc_scan_run             },
+      map_entry { "scan.stride"             , &Control::rc_scan_stride          },
+      map_entry { "stream.binary"           , &Control::rc_stream_binary        },
+      map_entry { "stream.sequence"         , &Control::rc_stream_sequence      },
+      map_entry { "system.baud"             , &Control::rc_system_baud          },
+      map_entry { "system.poll"             , &Control::rc_system_poll          },
+      map_entry { "system.rx_buffer"        , &Control::rc_system_rx_buffer     },
+      map_entry { "system.sync"             , &Control::rc_system_sync          },
+      map_entry { nullptr                   , nullptr                           }
+    };
+  // name -> rcode_map_ index, generated at compile time
+  static constexpr auto rcode_table_ = make_rcode_dispatch_table(rcode_map_);
+  static_assert(rcode_table_.valid(), "no perfect hash found for rcode_map_");
+public:
+  // command table lookups; public for the host benchmarks in sim/
   static auto rcode_map() -> const auto&
     {
-      static map_entry rm[] =
-        {
-          map_entry { "carriage.move.steps"     , &Control::rc_carriage_move_steps  },
-          map_entry { "carriage.auto_set_home"  , &Control::rc_carriage_set_home    },
-          map_entry { "carriage.auto_set_span"  , &Control::rc_carriage_set_span    },
-          map_entry { "log.debug"               , &Control::rc_log_info             },
-          map_entry { "log.error"               , &Control::rc_log_info             },
-          map_entry { "log.info"                , &Control::rc_log_info             },
-          map_entry { "log.warning"             , &Control::rc_log_info             },
-          map_entry { "platform.move.steps"     , &Control::rc_platform_move_steps  },
-          map_entry { "platform.speed"          , &Control::rc_platform_speed       },
-          map_entry { "rangefinder.ping"        , &Control::rc_rangefinder_ping     },
-          map_entry { "reboot"                  , &Control::rc_reboot               },
-          map_entry { "system.poll"             , &Control::rc_system_poll          },
-          map_entry { nullptr                   , nullptr                           }
-        };
-      return rm;
+      return rcode_map_;
+    }
+  static auto find_function(const char* name, size_t length) -> const map_entry*
+    {
+      return rcode_table_.find(rcode_map_, name, length);
     }
 template<typename CallbackT>
   static auto for_each_function(CallbackT&& callback)
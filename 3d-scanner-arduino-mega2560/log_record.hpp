@@ -0,0 +1,191 @@
+/*
+MIT License
+
+Copyright (c) 2020 Robert T. Adams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef log_record_hpp_20261017_214833_PDT
+#define log_record_hpp_20261017_214833_PDT
+
+#include "scan_frame.hpp"
+#include <stddef.h>
+#include <stdint.h>
+
+// Log messages the firmware can send as a binary record ("log.binary=1")
+// instead of text.  Each has a fixed format in which every '%' stands for an
+// integer argument; the host renders a record back into exactly the line the
+// firmware would have printed.  Append new messages; never renumber.
+enum class LogMessage : uint8_t
+{
+  rebooting,
+  searching_home,
+  homing_complete,
+  searching_limit,
+  limit_found,
+  limit_not_found,
+  carriage_max,
+  moving_carriage,
+  moving_platform,
+  range_measurement,
+  out_of_range,
+  scanning_layer,
+  line_too_long,
+  value_out_of_range,
+  resuming_scan,
+  count_
+};
+
+// On the wire a record is 6 + 4 * argument count bytes, little endian:
+//
+//   0     sync (0xa6)
+//   1     level (LOG_LEVEL_* in logger.hpp)
+//   2     message (LogMessage)
+//   3     argument count, 0-3
+//   4-    arguments, 32-bit signed each
+//   last  CRC-16/CCITT over the bytes before it
+//
+// Like ScanFrame's, the sync byte never occurs in text.  As with
+// scan_frame.hpp, client/log_record.hpp is a symlink to this header.
+struct LogRecord
+{
+  static constexpr uint8_t  sync_         = 0xa6;
+  static constexpr size_t   header_size_  = 4;
+  static constexpr size_t   max_args_     = 3;
+  static constexpr size_t   max_size_     = header_size_ + 4 * max_args_ + 2;
+
+  uint8_t     level     = 0;
+  LogMessage  message   = LogMessage::rebooting;
+  uint8_t     arg_count = 0;
+  int32_t     args[max_args_] = {};
+
+  static auto format(LogMessage m) -> const char*
+    {
+      switch(m)
+      {
+      case LogMessage::rebooting:           return "Rebooting...";
+      case LogMessage::searching_home:      return "Searching for home...";
+      case LogMessage::homing_complete:     return "Homing complete.";
+      case LogMessage::searching_limit:     return "Searching for the carriage limit...";
+      case LogMessage::limit_found:         return "Carriage limit found.";
+      case LogMessage::limit_not_found:     return "Limit switch not found.";
+      case LogMessage::carriage_max:        return "carriage_max_ == %";
+      case LogMessage::moving_carriage:     return "Moving carriage % steps";
+      case LogMessage::moving_platform:     return "Moving platform % steps";
+      case LogMessage::range_measurement:   return "Single range measurement";
+      case LogMessage::out_of_range:        return "Out of range";
+      case LogMessage::scanning_layer:      return "Scanning layer %";
+      case LogMessage::line_too_long:       return "Line too long; discarded";
+      case LogMessage::value_out_of_range:  return "Value out of range [%, %]: %";
+      case LogMessage::resuming_scan:       return "Resuming the scan at layer %, sample %";
+      default:                              return nullptr;
+      }
+    }
+  // Calls text(begin, length) for each literal run of the message's format
+  // and number(value) for each argument, in order.
+template<typename TextF, typename NumberF>
+  auto render(TextF&& text, NumberF&& number) const -> void
+    {
+      auto f = format(message);
+      if(f == nullptr)
+      {
+        return;
+      }
+      uint8_t arg = 0;
+      auto    run = f;
+      for(; *f != '\0'; ++f)
+      {
+        if(*f == '%')
+        {
+          text(run, static_cast<size_t>(f - run));
+          number(arg < arg_count? args[arg] : 0);
+          ++arg;
+          run = f + 1;
+        }
+      }
+      text(run, static_cast<size_t>(f - run));
+    }
+
+  auto size() const -> size_t
+    {
+      return header_size_ + 4 * arg_count + 2;
+    }
+  // out must hold size() bytes
+  auto encode(uint8_t* out) const -> size_t
+    {
+      out[0] = sync_;
+      out[1] = level;
+      out[2] = static_cast<uint8_t>(message);
+      out[3] = arg_count;
+      size_t n = header_size_;
+      for(uint8_t i = 0; i < arg_count; ++i, n += 4)
+      {
+        auto v = static_cast<uint32_t>(args[i]);
+        out[n]     = static_cast<uint8_t>(v);
+        out[n + 1] = static_cast<uint8_t>(v >> 8);
+        out[n + 2] = static_cast<uint8_t>(v >> 16);
+        out[n + 3] = static_cast<uint8_t>(v >> 24);
+      }
+      auto crc = ScanFrame::crc16(out, n);
+      out[n]     = static_cast<uint8_t>(crc);
+      out[n + 1] = static_cast<uint8_t>(crc >> 8);
+      return n + 2;
+    }
+  // Bytes a record starting at in[0] occupies, judged from its header: 0 if
+  // in[0, available) is too short to tell.
+  static auto size_of(const uint8_t* in, size_t available) -> size_t
+    {
+      if(available < header_size_)
+      {
+        return 0;
+      }
+      return header_size_ + 4 * (in[3] <= max_args_? in[3] : 0) + 2;
+    }
+  // returns false, leaving result untouched, unless in[0, size_of(in)) is a
+  // record with a valid sync byte, known message and checksum
+  static auto decode(const uint8_t* in, LogRecord& result) -> bool
+    {
+      if(in[0] != sync_ || in[3] > max_args_ || in[2] >= static_cast<uint8_t>(LogMessage::count_))
+      {
+        return false;
+      }
+      size_t  n   = header_size_ + 4 * in[3];
+      auto    crc = ScanFrame::crc16(in, n);
+      if(in[n] != static_cast<uint8_t>(crc) || in[n + 1] != static_cast<uint8_t>(crc >> 8))
+      {
+        return false;
+      }
+      result.level      = in[1];
+      result.message    = static_cast<LogMessage>(in[2]);
+      result.arg_count  = in[3];
+      for(uint8_t i = 0; i < result.arg_count; ++i)
+      {
+        auto p = in + header_size_ + 4 * i;
+        result.args[i] = static_cast<int32_t>(
+          static_cast<uint32_t>(p[0])
+          | static_cast<uint32_t>(p[1]) << 8
+          | static_cast<uint32_t>(p[2]) << 16
+          | static_cast<uint32_t>(p[3]) << 24
+        );
+      }
+      return true;
+    }
+};
+
+#endif//log_record_hpp_20261017_214833_PDT
@@ -24,68 +24,135 @@ SOFTWARE.
 #ifndef logger_hpp_20200616_120255_PDT
 #define logger_hpp_20200616_120255_PDT
 
+#include "log_record.hpp"
 #include <Arduino.h>
 
+// Messages below LOG_LEVEL are compiled out: calls to a disabled level are
+// empty inline functions.  Build with -DLOG_LEVEL=LOG_LEVEL_DEBUG to get the
+// lexer and parser traces back.
+#define LOG_LEVEL_DEBUG   0
+#define LOG_LEVEL_INFO    1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_ERROR   3
+#define LOG_LEVEL_NONE    4
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
 class Log
 {
   Log() {};
 public:
-  static auto error() -> Log&
+  // one per level; a level that is compiled in can still be switched off at
+  // run time
+template<int LevelV>
+  class Channel
+  {
+  public:
+    static constexpr bool compiled_in_ = LevelV >= LOG_LEVEL;
+
+  template<typename...ArgsT>
+    auto operator()(ArgsT&&...args) -> void
+      {
+        if constexpr(compiled_in_)
+        {
+          if(is_enabled_)
+          {
+            write(args..., "\n");
+          }
+        }
+      }
+    // a catalogued message (see log_record.hpp): a binary record when
+    // binary logging is on, else the same text as the other form
+  template<typename...ArgsT>
+    auto operator()(LogMessage m, ArgsT...args) -> void
+      {
+        static_assert(sizeof...(ArgsT) <= LogRecord::max_args_, "too many log arguments");
+        if constexpr(compiled_in_)
+        {
+          if(is_enabled_)
+          {
+            LogRecord record;
+            record.level      = LevelV;
+            record.message    = m;
+            record.arg_count  = sizeof...(ArgsT);
+            int32_t values[]  = { static_cast<int32_t>(args)..., 0 };
+            for(uint8_t i = 0; i < record.arg_count; ++i)
+            {
+              record.args[i] = values[i];
+            }
+            send(record);
+          }
+        }
+      }
+
+    auto set_enabled(bool b) -> void
+      {
+        is_enabled_ = b;
+      }
+    auto enable() -> void
+      {
+        set_enabled(true);
+      }
+    auto disable() -> void
+      { 
+        set_enabled(false);
+      }
+  private:
+    bool is_enabled_ = true;
+
+  template<typename FirstT>
+    auto write(FirstT&& first) -> void
+      {
+        Serial.print(first);
+      }
+  template<typename FirstT, typename...LastTs>
+    auto write(FirstT&& first, LastTs&&...last) -> void
+      {
+        write(first);
+        write(last...); 
+      }
+    auto send(const LogRecord& record) -> void
+      {
+        if(binary())
+        {
+          uint8_t bytes[LogRecord::max_size_];
+          Serial.write(bytes, record.encode(bytes));
+          return;
+        }
+        record.render(
+          [](const char* text, size_t length) { Serial.write(text, length); },
+          [](int32_t value) { Serial.print(value); }
+        );
+        Serial.print("\n");
+      }
+  };
+
+  static auto error() -> Channel<LOG_LEVEL_ERROR>&
     {
-      static Log l;
+      static Channel<LOG_LEVEL_ERROR> l;
       return l;
     }
-  static auto warning() -> Log&
+  static auto warning() -> Channel<LOG_LEVEL_WARNING>&
     {
-      static Log l;
+      static Channel<LOG_LEVEL_WARNING> l;
       return l;
     }
-  static auto info() -> Log&
+  static auto info() -> Channel<LOG_LEVEL_INFO>&
     {
-      static Log l;
+      static Channel<LOG_LEVEL_INFO> l;
       return l;
     }
-  static auto debug() -> Log&
+  static auto debug() -> Channel<LOG_LEVEL_DEBUG>&
     {
-      static Log l;
+      static Channel<LOG_LEVEL_DEBUG> l;
       return l;
     }
-  template<typename...ArgsT>
-  auto operator()(ArgsT&&...args) -> void { return print(args...); }
-
-  auto set_enabled(bool b) -> void
-    {
-      is_enabled_ = b;
-    }
-  auto enable() -> void
-    {
-      set_enabled(true);
-    }
-  auto disable() -> void
-    { 
-      set_enabled(false);
-    }
-private:
-  bool is_enabled_ = true;
-
-  template<typename...ArgsT>
-  auto print(ArgsT...args)
-    {
-      write(args..., "\n");
-    }
-  template<typename FirstT>
-  auto write(FirstT&& first) -> void
-    {
-      if(is_enabled_)
-      {
-        Serial.print(first);
-      }
-    }
-  template<typename FirstT, typename...LastTs>
-  auto write(FirstT&& first, LastTs&&...last) -> void
+  // catalogued messages go out as LogRecords ("log.binary")
+  static auto binary() -> bool&
     {
-      write(first);
-      write(last...); 
+      static bool b = false;
+      return b;
     }
 };
 
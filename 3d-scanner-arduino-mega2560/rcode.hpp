@@ -26,6 +26,7 @@ SOFTWARE.
 
 #include "rcode_lexer.hpp"
 #include <stddef.h>
+#include <stdint.h>
 #include <Arduino.h>
 
 template<typename T>
@@ -40,10 +41,14 @@ public:
   enum class Command { invalid, get, set };
   enum class Error   
     { ok
-    , expected_end_of_line
+    , expected_end_of_statement
     , expected_identifier 
     , invalid_data 
     };
+  // what the data was written as; numbers are converted while parsing, so
+  // handlers read integer() or fixed() instead of rescanning data()
+  enum class Type { none, integer, fixed, string };
+  static constexpr int32_t fixed_scale_ = 1000; // fixed() is in thousandths
 
   RCode(const RCode&) = default;
   RCode(RCode&&) = default;
@@ -72,30 +77,67 @@ public:
   auto command() const        -> const Command&   { return command_;  }
   auto data() const           -> const string_t&  { return data_;     }
   auto error() const          -> const Error&     { return error_;    }
+  auto type() const           -> const Type&      { return type_;     }
+  auto integer() const        -> int32_t          { return number_;   }
+  // an integer too large to scale saturates
+  auto fixed() const          -> int32_t 
+    {
+      constexpr int32_t limit = INT32_MAX / fixed_scale_;
+      return type_ != Type::integer ? number_
+           : number_ >  limit       ? INT32_MAX
+           : number_ < -limit       ? -INT32_MAX
+           :                          number_ * fixed_scale_;
+    }
 
-  static auto parse(const string_t& source) -> RCode 
+  using lexer_t     = rcode_lexer<string_t>;
+
+  // A line holds one or more statements separated by ';':
+  //
+  //   name [= data] { ; name [= data] } [;]
+  //
+  // parse() reads the statement at the lexer's position and leaves the lexer
+  // after its ';', so calling it until lexer.at_end() walks a whole line.  An
+  // empty statement parses as an empty name.
+  static auto parse(lexer_t& lexer) -> RCode 
     {
       RCode result;
-      using lexer_t = rcode_lexer<string_t>;
-      using token_t = decltype(lexer_t(source).scan());
-      auto lexer = lexer_t(source); 
-      auto expect_end_of_line = [&]
+      using token_t = decltype(lexer.scan());
+      auto is_end_of_statement = [&](const token_t& t)
+        {
+          return t.id == token_t::END_OF_LINE || t.id == token_t::SEMICOLON;
+        };
+      auto expect_end_of_statement = [&]
         {
-          auto eol_token = lexer.scan();
-          if( eol_token.id != token_t::END_OF_LINE)
+          if(is_end_of_statement(lexer.scan()) == false)
           {
-            result.error_ = Error::expected_end_of_line;
+            result.error_ = Error::expected_end_of_statement;
           }
         };
       auto expect_data = [&]
         {
           auto data_token = lexer.scan();
-          if( data_token.id == token_t::INTEGER
-           || data_token.id == token_t::FLOAT
-           || data_token.id == token_t::STRING
-          )
+          result.data_ = lexer.get_symbol(data_token);
+          bool converted = true;
+          switch(data_token.id)
           {
-            result.data_ = lexer.get_symbol(data_token);
+          case token_t::INTEGER:
+            result.type_  = Type::integer;
+            converted     = to_number(result.data_, 1, result.number_);
+            break;
+          case token_t::FLOAT:
+            result.type_  = Type::fixed;
+            converted     = to_number(result.data_, fixed_scale_, result.number_);
+            break;
+          case token_t::STRING:
+            result.type_  = Type::string;
+            break;
+          default:
+            converted     = false;
+            break;
+          }
+          if(converted)
+          {
+            expect_end_of_statement();
           }
           else
           {
@@ -104,16 +146,19 @@ public:
         };
       auto allow_assignment_op = [&]
         {
-          auto assignment_token = lexer.scan();
-          if(assignment_token.id == token_t::OP_ASSIGN)
+          auto token = lexer.scan();
+          if(token.id == token_t::OP_ASSIGN)
           {
             result.command_ = Command::set;
             expect_data();
           }
-          else
+          else if(is_end_of_statement(token))
           {
             result.command_ = Command::get;
-            expect_end_of_line();
+          }
+          else
+          {
+            result.error_ = Error::expected_end_of_statement;
           }
         };
       auto expect_identifier = [&]
@@ -124,7 +169,7 @@ public:
             result.name_ = lexer.get_symbol(id_token);
             allow_assignment_op();
           }
-          else if(id_token.id == token_t::INVALID)
+          else if(is_end_of_statement(id_token) == false)
           {
             result.error_ = Error::expected_identifier;
           }
@@ -136,9 +181,71 @@ public:
       start_parsing();
       return result;
     }
+  // the first statement of source
+  static auto parse(const string_t& source) -> RCode 
+    {
+      auto lexer = lexer_t(source); 
+      return parse(lexer);
+    }
 private:
+  // Reads [sign] digits [. digits]; scale is 1 for an integer, or
+  // fixed_scale_ to keep that many decimals of a float and drop the rest.
+  // Fails when the value doesn't fit in an int32_t, or on anything after the
+  // number: the lexer takes "5-3" as one INTEGER token.
+  static auto to_number(const string_t& text, int32_t scale, int32_t& value) -> bool 
+    {
+      auto i        = text.begin();
+      auto negative = i != text.end() && *i == '-';
+      if(i != text.end() && (*i == '-' || *i == '+'))
+      {
+        ++i;
+      }
+      int32_t magnitude = 0;
+      auto accumulate = [&](char digit)
+        {
+          if(magnitude > (INT32_MAX - (digit - '0')) / 10)
+          {
+            return false;
+          }
+          magnitude = magnitude * 10 + (digit - '0');
+          return true;
+        };
+      for(; i != text.end() && *i >= '0' && *i <= '9'; ++i)
+      {
+        if(accumulate(*i) == false)
+        {
+          return false;
+        }
+      }
+      if(scale > 1 && i != text.end() && *i == '.')
+      {
+        ++i;
+      }
+      for(int32_t s = scale; s > 1; s /= 10)
+      {
+        bool more = i != text.end() && *i >= '0' && *i <= '9';
+        if(accumulate(more? *i : '0') == false)
+        {
+          return false;
+        }
+        i += more;
+      }
+      while(scale > 1 && i != text.end() && *i >= '0' && *i <= '9')
+      {
+        ++i;
+      }
+      if(i != text.end())
+      {
+        return false;
+      }
+      value = negative? -magnitude : magnitude;
+      return true;
+    }
+
   Command     command_ = Command::invalid;
   Error       error_   = Error::ok;
+  Type        type_    = Type::none;
+  int32_t     number_  = 0;
   string_t    name_;
   string_t    data_;
 };
@@ -0,0 +1,218 @@
+/*
+MIT License
+
+Copyright (c) 2020 Robert T. Adams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef rcode_dispatch_hpp_20261017_094418_PDT
+#define rcode_dispatch_hpp_20261017_094418_PDT
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace rcode_dispatch_detail
+  {
+    constexpr auto next_power_of_two(size_t n) -> size_t
+      {
+        size_t result = 1;
+        while(result < n) 
+        { 
+          result <<= 1; 
+        }
+        return result;
+      }
+    constexpr auto string_end(const char* s) -> const char*
+      {
+        while(*s != '\0') 
+        { 
+          ++s; 
+        }
+        return s;
+      }
+  }
+
+// Perfect hash over a null-terminated table of named entries (anything with a
+// `const char* name` member, ending in an entry whose name is nullptr).
+//
+// Uses hash-and-displace: every name is hashed once with a seed chosen so all
+// hashes are distinct; the low bits pick a bucket, and each bucket stores a
+// displacement that scatters its names into free slots.  Seeds, displacements
+// and slots are all found at compile time, so a lookup at runtime costs one
+// pass over the name, a couple of table reads and a single string compare.
+template<size_t N>
+class rcode_dispatch_table
+{
+public:
+  using hash_t  = uint16_t;
+  using index_t = uint8_t;
+
+  static constexpr size_t   entry_count_    = N;
+  static constexpr size_t   bucket_count_   = rcode_dispatch_detail::next_power_of_two((N + 1) / 2);
+  static constexpr size_t   slot_count_     = rcode_dispatch_detail::next_power_of_two(2 * N);
+  static constexpr hash_t   seed_limit_     = 256;
+  static constexpr unsigned displace_limit_ = 256;
+  static constexpr index_t  empty_slot_     = 0xff;
+
+  static_assert(N < empty_slot_, "too many entries for an 8-bit slot index");
+
+template<typename EntryT>
+  constexpr rcode_dispatch_table(const EntryT (&entries)[N + 1])
+  : seed_(seed_limit_)
+  , displacements_{}
+  , slots_{}
+    {
+      for(hash_t seed = 0; seed < seed_limit_; ++seed)
+      {
+        if(try_seed(entries, seed))
+        {
+          seed_ = seed;
+          return;
+        }
+      }
+    }
+
+  constexpr auto valid() const -> bool { return seed_ < seed_limit_; }
+
+  static constexpr auto hash(const char* begin, const char* end, hash_t seed) -> hash_t
+    {
+      hash_t h = seed ^ 0x811c;
+      for(; begin != end; ++begin)
+      {
+        h = (h ^ static_cast<uint8_t>(*begin)) * 0x0193u;
+      }
+      return h;
+    }
+
+  // returns the entry named [name, name + length), or nullptr
+template<typename EntryT>
+  auto find(const EntryT* entries, const char* name, size_t length) const -> const EntryT*
+    {
+      auto h      = hash(name, name + length, seed_);
+      auto index  = slots_[slot(h, displacements_[bucket(h)])];
+      if(index == empty_slot_)
+      {
+        return nullptr;
+      }
+      const auto& entry = entries[index];
+      if(strncmp(entry.name, name, length) != 0 || entry.name[length] != '\0')
+      {
+        return nullptr;
+      }
+      return &entry;
+    }
+private:
+  hash_t  seed_;
+  uint8_t displacements_[bucket_count_];
+  index_t slots_[slot_count_];
+
+  static constexpr auto bucket(hash_t h) -> size_t
+    {
+      return h & (bucket_count_ - 1);
+    }
+  static constexpr auto slot(hash_t h, uint8_t displacement) -> size_t
+    {
+      hash_t x = (h ^ (displacement * 0x9e37u)) * 0x5bd1u;
+      return (x ^ (x >> 8)) & (slot_count_ - 1);
+    }
+template<typename EntryT>
+  constexpr auto try_seed(const EntryT (&entries)[N + 1], hash_t seed) -> bool
+    {
+      hash_t  hashes[N]         = {};
+      size_t  bucket_sizes[bucket_count_] = {};
+      size_t  largest_bucket    = 0;
+      for(size_t i = 0; i < N; ++i)
+      {
+        auto name = entries[i].name;
+        hashes[i] = hash(name, rcode_dispatch_detail::string_end(name), seed);
+        for(size_t j = 0; j < i; ++j)
+        {
+          if(hashes[j] == hashes[i])
+          {
+            return false;
+          }
+        }
+        auto size = ++bucket_sizes[bucket(hashes[i])];
+        largest_bucket = size > largest_bucket? size : largest_bucket;
+      }
+      for(size_t i = 0; i < slot_count_; ++i)
+      {
+        slots_[i] = empty_slot_;
+      }
+      // place the crowded buckets first, while the table is still sparse
+      for(auto size = largest_bucket; size > 0; --size)
+      {
+        for(size_t b = 0; b < bucket_count_; ++b)
+        {
+          if(bucket_sizes[b] == size && place_bucket(hashes, b) == false)
+          {
+            return false;
+          }
+        }
+      }
+      return true;
+    }
+  constexpr auto place_bucket(const hash_t (&hashes)[N], size_t b) -> bool
+    {
+      for(unsigned d = 0; d < displace_limit_; ++d)
+      {
+        auto fits = true;
+        for(size_t i = 0; i < N && fits; ++i)
+        {
+          if(bucket(hashes[i]) != b)
+          {
+            continue;
+          }
+          auto s = slot(hashes[i], d);
+          if(slots_[s] != empty_slot_)
+          {
+            fits = false;
+          }
+          else
+          {
+            slots_[s] = static_cast<index_t>(i);
+          }
+        }
+        if(fits)
+        {
+          displacements_[b] = static_cast<uint8_t>(d);
+          return true;
+        }
+        // undo the partial placement before trying the next displacement
+        for(size_t i = 0; i < slot_count_; ++i)
+        {
+          if(slots_[i] != empty_slot_ && bucket(hashes[slots_[i]]) == b)
+          {
+            slots_[i] = empty_slot_;
+          }
+        }
+      }
+      return false;
+    }
+};
+
+// deduces the entry count from a null-terminated map
+template<typename EntryT, size_t M>
+constexpr auto make_rcode_dispatch_table(const EntryT (&entries)[M]) -> rcode_dispatch_table<M - 1>
+  {
+    return rcode_dispatch_table<M - 1>(entries);
+  }
+
+#endif//rcode_dispatch_hpp_20261017_094418_PDT
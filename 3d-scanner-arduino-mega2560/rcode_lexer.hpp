@@ -2,6 +2,9 @@
 #define rcode_lexer_hpp_20200621_145638_PDT
 
 #include "logger.hpp"
+#include "string_slice.hpp"
+#include <avr/pgmspace.h>
+#include <stdint.h>
 
 template<typename T>
 class rcode_lexer
@@ -10,6 +13,9 @@ public:
   using string_t      = T;
   using iter_t        = const char*;
   using char_t        = char;
+  // OP_MINUS only comes from a number ending in a sign ("5-"), and SUFFIX
+  // is never produced; both are kept so the ids, and so the token stream,
+  // stay those of the original hand-written lexer.
   struct token_t 
     {
       enum id_t 
@@ -20,6 +26,7 @@ public:
         , INVALID 
         , OP_ASSIGN
         , OP_MINUS
+        , SEMICOLON
         , STRING
         , SUFFIX
         };
@@ -29,11 +36,20 @@ public:
     };
   rcode_lexer(const string_t& s)
   : source_(s)
-  , next_(s.c_str())
+  , next_(s.begin())
   , end_(next_ + s.length())
     {}
 
   auto scan() -> token_t { return do_scan(); }
+  // nothing but whitespace left to scan
+  auto at_end() -> bool
+    {
+      while(char_class() == cc_space)
+      {
+        ++next_;
+      }
+      return char_class() == cc_end;
+    }
   static auto get_symbol(const token_t& t) -> string_t { return do_get_symbol(t); }
 private:
   static constexpr char_t end_of_line_char  = 0;
@@ -41,6 +57,7 @@ private:
   static constexpr char_t eq_char           = '=';
   static constexpr char_t minus_char        = '-';
   static constexpr char_t plus_char         = '+';
+  static constexpr char_t semicolon_char    = ';';
   static constexpr char_t start_quote_char  = '"';
   static constexpr char_t end_quote_char    = '"';
   static constexpr char_t underscore_char   = '_';
@@ -51,157 +68,177 @@ private:
 
   static auto do_get_symbol(const token_t& token) -> string_t
     {
-      string_t result;
-      if(token.begin < token.end)
+      return make_symbol(token.begin, token.end, static_cast<const string_t*>(nullptr));
+    }
+  // slices just point back into the source, no copy
+  static auto make_symbol(iter_t begin, iter_t end, const string_slice*) -> string_slice
+    {
+      return string_slice(begin, end);
+    }
+template<typename StringT>
+  static auto make_symbol(iter_t begin, iter_t end, const StringT*) -> StringT
+    {
+      StringT result;
+      if(begin < end)
       { 
-        for(iter_t i = token.begin; i < token.end; ++i)
+        for(iter_t i = begin; i < end; ++i)
         {
           result += *i; 
         }
       }
       return result;
     }
-  auto do_scan() -> token_t 
+  // The scanner is a DFA over character classes.  Both tables are built at
+  // compile time and live in flash; a scan step is two table reads.
+  enum char_class_t : uint8_t
+    { cc_end
+    , cc_space
+    , cc_alpha
+    , cc_digit
+    , cc_underscore
+    , cc_dot
+    , cc_sign
+    , cc_eq
+    , cc_semicolon
+    , cc_quote
+    , cc_other
+    , cc_count
+    };
+  enum state_t : uint8_t
+    { st_start
+    , st_identifier
+    , st_number         // after a leading digit, where a sign may follow
+    , st_number_sign    // digit then sign
+    , st_integer
+    , st_fraction_start
+    , st_fraction
+    , st_sign           // leading sign
+    , st_string
+    , st_count
+    };
+  // A transition holds the next state, which always consumes the current
+  // character, or with emit_ the id of the token it ends.
+  static constexpr uint8_t emit_        = 0x80;
+  static constexpr uint8_t advance_     = 0x40; // emit_: the token includes it
+  static constexpr uint8_t skip_        = 0x20; // emit_: consume it, but not in the token
+  static constexpr uint8_t mark_begin_  = 0x10; // the token starts after it
+  static constexpr uint8_t value_mask_  = 0x0f;
+
+  struct tables_t
+  {
+    uint8_t classes[128];                   // bytes above 127 are cc_other
+    uint8_t transitions[st_count][cc_count];
+  };
+  static constexpr auto make_tables() -> tables_t
     {
-      typename token_t::id_t    token_id = token_t::INVALID;
-      iter_t                    token_begin = next_;
-      iter_t                    token_end   = next_;
-      auto accept = [&](const auto& t)
-        {
-          token_id  = t; 
-          token_end = next_;
-        };
-      auto peek = [&]
-        {
-          return next_ >= end_? end_of_line_char : *(next_);
-        };
-      auto advance = [&]
-        {
-          ++next_;
-        };
-      auto update_start = [&]
-        {
-          token_begin = next_;
-        };
-      auto skip_whitespace = [&]
-        {
-          while(isspace(peek()))
-          {
-            advance();
-          }
-          update_start();
-        };
-      auto scan_identifier = [&]
+      tables_t t {};
+      for(int c = 0; c < 128; ++c)
+      {
+        t.classes[c]
+          = c == end_of_line_char                     ? cc_end
+          : c == ' ' || (c >= '\t' && c <= '\r')      ? cc_space
+          : (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ? cc_alpha
+          : c >= '0' && c <= '9'                      ? cc_digit
+          : c == underscore_char                      ? cc_underscore
+          : c == dot_char                             ? cc_dot
+          : c == minus_char || c == plus_char         ? cc_sign
+          : c == eq_char                              ? cc_eq
+          : c == semicolon_char                       ? cc_semicolon
+          : c == start_quote_char                     ? cc_quote
+          :                                             cc_other;
+      }
+      auto state = [&](state_t s, uint8_t otherwise) -> uint8_t*
         {
-          while
-            (  isalpha(peek()) 
-            || isdigit(peek()) 
-            || peek() == underscore_char
-            || peek() == dot_char
-            )
+          for(auto& entry : t.transitions[s])
           {
-            advance();
+            entry = otherwise;
           }
-          accept(token_t::IDENTIFIER);
+          return t.transitions[s];
         };
-      auto scan_string = [&]
+      auto emit = [](typename token_t::id_t id) -> uint8_t
         {
-          while(peek() != end_quote_char)
-          {
-            if(peek() == end_of_line_char) 
-            {
-              accept(token_t::INVALID);
-              return;
-            }
-            advance();
-          }
-          advance();
+          return emit_ | id;
         };
-      auto scan_number = [&]
-        {
-          auto consume_digits = [&]
-            {
-              while(isdigit(peek()))
-              {
-                advance();
-              }
-            };
-          auto scan_float = [&]
-            {
-              if(isdigit(peek()))
-              {
-                consume_digits();
-                accept(token_t::FLOAT);
-              }
-              else
-              {
-                accept(token_t::INVALID);
-              }
-            };
-          if(peek() == minus_char || peek() == plus_char)
-          {
-            advance();
-            if(isdigit(peek()) == false)
-            {
-              accept(token_t::OP_MINUS);
-              return;
-            }
-          }
-          consume_digits();
-          if(peek() == dot_char)
-          {
-            advance();
-            scan_float();
-          }
-          else
-          {
-            accept(token_t::INTEGER);
-          }
-        };
-      ////////////////////////
-      skip_whitespace();
-      if(isalpha(peek()))
-      {
-        advance();
-        scan_identifier();
-      }
-      else if(peek() == eq_char)
+      auto s = state(st_start, emit(token_t::INVALID));  // nothing consumed
+      s[cc_alpha]       = st_identifier;
+      s[cc_digit]       = st_number;
+      s[cc_sign]        = st_sign;
+      s[cc_eq]          = advance_ | emit(token_t::OP_ASSIGN);
+      s[cc_semicolon]   = advance_ | emit(token_t::SEMICOLON);
+      s[cc_quote]       = mark_begin_ | st_string;
+      s[cc_end]         = emit(token_t::END_OF_LINE);
+      s = state(st_identifier, emit(token_t::IDENTIFIER));
+      s[cc_alpha]       = st_identifier;
+      s[cc_digit]       = st_identifier;
+      s[cc_underscore]  = st_identifier;
+      s[cc_dot]         = st_identifier;
+      s = state(st_number, emit(token_t::INTEGER));
+      s[cc_sign]        = st_number_sign;
+      s[cc_digit]       = st_integer;
+      s[cc_dot]         = st_fraction_start;
+      s = state(st_number_sign, emit(token_t::OP_MINUS));
+      s[cc_digit]       = st_integer;
+      s = state(st_integer, emit(token_t::INTEGER));
+      s[cc_digit]       = st_integer;
+      s[cc_dot]         = st_fraction_start;
+      s = state(st_fraction_start, emit(token_t::INVALID));
+      s[cc_digit]       = st_fraction;
+      s = state(st_fraction, emit(token_t::FLOAT));
+      s[cc_digit]       = st_fraction;
+      s = state(st_sign, emit(token_t::INVALID));
+      s[cc_digit]       = st_integer;
+      // the token is the text between the quotes
+      s = state(st_string, st_string);
+      s[cc_quote]       = skip_ | emit(token_t::STRING);
+      s[cc_end]         = emit(token_t::INVALID);
+      return t;
+    }
+  static constexpr tables_t tables_ PROGMEM = make_tables();
+
+  auto char_class() const -> char_class_t
+    {
+      if(next_ >= end_)
       {
-        advance();
-        accept(token_t::OP_ASSIGN);       
+        return cc_end;
       }
-      else if(isdigit(peek()))
+      auto c = static_cast<uint8_t>(*next_);
+      return c < 128? static_cast<char_class_t>(pgm_read_byte(&tables_.classes[c])) : cc_other;
+    }
+  // Every transition that does not end the token consumes a character, so
+  // the loop only needs the table to decide when to stop.  A run of one state
+  // (an identifier, digits, a string's text) gets an inner loop of its own:
+  // with the state fixed, each read no longer waits on the one before it.
+  auto do_scan() -> token_t
+    {
+      while(char_class() == cc_space)
       {
-        advance();
-        scan_number();
+        ++next_;
       }
-      else if(peek() == minus_char || peek() == plus_char)
+      iter_t    token_begin = next_;
+      unsigned  t           = pgm_read_byte(&tables_.transitions[st_start][char_class()]);
+      while((t & emit_) == 0)
       {
-        advance();
-        if(isdigit(peek()))
+        ++next_;
+        if(t & mark_begin_)
         {
-          scan_number();
+          token_begin = next_;
         }
-        else
+        auto state = t & value_mask_;
+        t = pgm_read_byte(&tables_.transitions[state][char_class()]);
+        while(t == state)
         {
-          accept(token_t::INVALID);
+          ++next_;
+          t = pgm_read_byte(&tables_.transitions[state][char_class()]);
         }
       }
-      else if(peek() == start_quote_char)
-      {
-        advance();
-        update_start();
-        scan_string();
-      }
-      else if(peek() == end_of_line_char)
-      {
-        accept(token_t::END_OF_LINE);
-      }
+      next_ += (t & advance_) != 0;
+      iter_t token_end = next_;
+      next_ += (t & skip_) != 0;
+      auto token_id = static_cast<typename token_t::id_t>(t & value_mask_);
       Log::debug()
         ( "Token contents: "
-        , static_cast<int>(token_id),      ", "
-        , static_cast<char>(*token_begin), ", "
-        , static_cast<char>(*token_end),   ", "
+        , static_cast<int>(token_id), ", \""
+        , string_slice(token_begin, token_end), "\""
         );
       return token_t { token_id, token_begin, token_end };
     }
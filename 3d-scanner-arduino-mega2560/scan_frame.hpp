@@ -0,0 +1,110 @@
+/*
+MIT License
+
+Copyright (c) 2020 Robert T. Adams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef scan_frame_hpp_20261017_104652_PDT
+#define scan_frame_hpp_20261017_104652_PDT
+
+#include <stddef.h>
+#include <stdint.h>
+
+// One range sample in the binary scan stream ("stream.binary=1").  On the
+// wire a frame is a fixed 13 bytes, multi-byte fields little endian:
+//
+//   0     sync (0xa5)
+//   1-2   sequence number, wraps at 65536
+//   3-4   platform step within the revolution, from where scan.run began
+//   5-6   carriage position, steps above home
+//   7-8   range, mm (filtered, see rangefinder.reads)
+//   9     VL53L0X range status (4 == phase failure / out of range)
+//   10    confidence in the range, 0-255
+//   11-12 CRC-16/CCITT over bytes 0-10
+//
+// Text (log messages, "#..." markers) may be interleaved between frames; it
+// is plain ASCII and so never contains the sync byte.  client/scan_frame.hpp is
+// a symlink to this header, so both ends build from the same definition.
+struct ScanFrame
+{
+  static constexpr uint8_t  sync_         = 0xa5;
+  static constexpr size_t   size_         = 13;
+  static constexpr uint8_t  status_ok_    = 0;
+
+  uint16_t  sequence          = 0;
+  int16_t   platform_step     = 0;
+  int16_t   carriage_position = 0;
+  uint16_t  range_mm          = 0;
+  uint8_t   status            = 0;
+  uint8_t   confidence        = 0;
+
+  auto encode(uint8_t* out) const -> void
+    {
+      out[0] = sync_;
+      put16(out + 1, sequence);
+      put16(out + 3, static_cast<uint16_t>(platform_step));
+      put16(out + 5, static_cast<uint16_t>(carriage_position));
+      put16(out + 7, range_mm);
+      out[9]  = status;
+      out[10] = confidence;
+      put16(out + 11, crc16(out, size_ - 2));
+    }
+  // returns false, leaving result untouched, unless in[0, size_) is a frame
+  // with a valid sync byte and checksum
+  static auto decode(const uint8_t* in, ScanFrame& result) -> bool
+    {
+      if(in[0] != sync_ || get16(in + 11) != crc16(in, size_ - 2))
+      {
+        return false;
+      }
+      result.sequence           = get16(in + 1);
+      result.platform_step      = static_cast<int16_t>(get16(in + 3));
+      result.carriage_position  = static_cast<int16_t>(get16(in + 5));
+      result.range_mm           = get16(in + 7);
+      result.status             = in[9];
+      result.confidence         = in[10];
+      return true;
+    }
+  static auto crc16(const uint8_t* data, size_t length) -> uint16_t
+    {
+      uint16_t crc = 0xffff;
+      while(length--)
+      {
+        crc ^= static_cast<uint16_t>(*data++) << 8;
+        for(int bit = 0; bit < 8; ++bit)
+        {
+          crc = (crc & 0x8000)? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+      }
+      return crc;
+    }
+private:
+  static auto put16(uint8_t* out, uint16_t v) -> void
+    {
+      out[0] = static_cast<uint8_t>(v & 0xff);
+      out[1] = static_cast<uint8_t>(v >> 8);
+    }
+  static auto get16(const uint8_t* in) -> uint16_t
+    {
+      return static_cast<uint16_t>(in[0] | (in[1] << 8));
+    }
+};
+
+#endif//scan_frame_hpp_20261017_104652_PDT
@@ -0,0 +1,109 @@
+/*
+MIT License
+
+Copyright (c) 2020 Robert T. Adams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Commands per second through Control's rcode lookup: the compile-time
+// perfect hash against the linear scan over rcode_map() it replaced.
+//
+//   bench-dispatch [ROUNDS]
+//
+// Each round looks up every command name in the map once, plus a few names
+// that are not in it, as the firmware would for a line it does not know.
+#include "control.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+  {
+    const char* const unknown_names_[] =
+      { "platform.sped"
+      , "carriage"
+      , "scan.runn"
+      , "x"
+      };
+
+    // the lookup run_command_processor() did before the hash table
+    auto find_linear(const string_slice& name) -> const void*
+      {
+        const void* found = nullptr;
+        Control::for_each_function(
+          [&](auto& f)
+            {
+              if(found == nullptr && name == f.name)
+              {
+                found = &f;
+              }
+            }
+        );
+        return found;
+      }
+    auto find_hashed(const string_slice& name) -> const void*
+      {
+        return Control::find_function(name.begin(), name.length());
+      }
+
+template<typename F>
+    auto run(const char* label, const std::vector<string_slice>& names, long rounds, F&& find) -> void
+      {
+        using namespace std;
+        using clock = chrono::steady_clock;
+        size_t found = 0;
+        auto start = clock::now();
+        for(long r = 0; r < rounds; ++r)
+        {
+          for(const auto& name : names)
+          {
+            found += find(name) != nullptr;
+          }
+        }
+        chrono::duration<double> elapsed = clock::now() - start;
+        auto lookups = static_cast<double>(names.size()) * rounds;
+        cout << label << ": " << lookups / elapsed.count() / 1e6 << " M commands/s"
+             << " (" << found << " found in " << lookups << ")" << endl;
+      }
+  }
+
+int main(int argc, char* argv[])
+{
+  using namespace std;
+  long rounds = argc > 1? atol(argv[1]) : 200000;
+  // copied, so neither lookup can compare pointers into the map
+  vector<string> storage;
+  Control::for_each_function([&](auto& f) { storage.push_back(f.name); });
+  for(auto name : unknown_names_)
+  {
+    storage.push_back(name);
+  }
+  vector<string_slice> names;
+  for(const auto& s : storage)
+  {
+    names.push_back(string_slice(s.data(), s.data() + s.size()));
+  }
+  cout << names.size() - size(unknown_names_) << " commands, " 
+       << size(unknown_names_) << " unknown names, " << rounds << " rounds" << endl;
+  run("linear scan", names, rounds, find_linear);
+  run("perfect hash", names, rounds, find_hashed);
+  return 0;
+}
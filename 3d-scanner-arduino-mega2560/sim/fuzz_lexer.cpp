@@ -0,0 +1,139 @@
+/*
+MIT License
+
+Copyright (c) 2020 Robert T. Adams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Differential fuzzer and benchmark for rcode_lexer.
+//
+//   fuzz-lexer [LINES [SEED]]
+//
+// Scans LINES random lines, mostly built from the characters the grammar
+// cares about, with both rcode_lexer and reference_rcode_lexer (the lexer it
+// replaced), and fails on the first difference in the token streams.  Then
+// reports tokens/s for both over a typical command line.
+#include "rcode_lexer.hpp"
+#include "reference_rcode_lexer.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace
+  {
+    constexpr char  alphabet_[]       = "aZ_.09-+=;\" \t\r#x\x01\xff";
+    constexpr int   max_line_length_  = 24;
+    constexpr int   max_tokens_       = 30;
+
+    const std::string benchmark_line_ 
+      = "platform.move.steps=-200;motion.wait;rangefinder.ping;log.info=\"x y\";scan.run=1.5";
+
+    auto random_line(std::mt19937& rng) -> std::string
+      {
+        std::string line;
+        auto length = rng() % max_line_length_;
+        for(unsigned i = 0; i < length; ++i)
+        {
+          line += rng() % 8 == 0? static_cast<char>(rng() % 256) : alphabet_[rng() % (sizeof(alphabet_) - 1)];
+        }
+        return line;
+      }
+    // An empty token's end is not compared: the reference lexer leaves an
+    // empty INVALID token's end before its begin.
+template<typename TokenA, typename TokenB>
+    auto same_token(const TokenA& a, const TokenB& b) -> bool
+      {
+        auto empty = a.end <= a.begin && b.end <= b.begin;
+        return static_cast<int>(a.id) == static_cast<int>(b.id)
+            && a.begin == b.begin
+            && (empty || a.end == b.end);
+      }
+    // returns the tokens compared, or -1 on a difference
+    auto compare(const std::string& line) -> long
+      {
+        auto source     = string_slice(line.data(), line.data() + line.size());
+        auto lexer      = rcode_lexer<string_slice>(source);
+        auto reference  = reference_rcode_lexer<string_slice>(source);
+        for(long n = 1; n <= max_tokens_; ++n)
+        {
+          auto a = lexer.scan();
+          auto b = reference.scan();
+          if(!same_token(a, b))
+          {
+            std::cout << "token " << n << " of \"" << line << "\": " 
+                      << a.id << " [" << a.begin - line.data() << ", " << a.end - line.data() << "), reference " 
+                      << b.id << " [" << b.begin - line.data() << ", " << b.end - line.data() << ")" << std::endl;
+            return -1;
+          }
+          if(a.id == decltype(a)::END_OF_LINE)
+          {
+            return n;
+          }
+          if(lexer.at_end() != reference.at_end())
+          {
+            std::cout << "at_end() differs after token " << n << " of \"" << line << "\"" << std::endl;
+            return -1;
+          }
+        }
+        return max_tokens_;
+      }
+template<typename LexerT>
+    auto tokens_per_second(long lines) -> double
+      {
+        auto source = string_slice(benchmark_line_.data(), benchmark_line_.data() + benchmark_line_.size());
+        long tokens = 0;
+        auto start  = std::chrono::steady_clock::now();
+        for(long i = 0; i < lines; ++i)
+        {
+          auto lexer = LexerT(source);
+          while(lexer.scan().id != LexerT::token_t::END_OF_LINE)
+          {
+            ++tokens;
+          }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return tokens / elapsed.count();
+      }
+  }
+
+int main(int argc, char* argv[])
+{
+  using namespace std;
+  long  lines = argc > 1? atol(argv[1]) : 2000000;
+  auto  seed  = argc > 2? strtoul(argv[2], nullptr, 10) : 42ul;
+  mt19937 rng(seed);
+  long tokens = 0;
+  for(long i = 0; i < lines; ++i)
+  {
+    auto n = compare(random_line(rng));
+    if(n < 0)
+    {
+      cout << "FAILED after " << i << " lines" << endl;
+      return 1;
+    }
+    tokens += n;
+  }
+  cout << lines << " lines, " << tokens << " tokens, no differences" << endl;
+  auto rounds = max(lines / 2, 1l);
+  cout << "rcode_lexer:           " << tokens_per_second<rcode_lexer<string_slice>>(rounds) / 1e6 << " M tokens/s" << endl;
+  cout << "reference_rcode_lexer: " << tokens_per_second<reference_rcode_lexer<string_slice>>(rounds) / 1e6 << " M tokens/s" << endl;
+  return 0;
+}
@@ -0,0 +1,62 @@
+/*
+MIT License
+
+Copyright (c) 2020 Robert T. Adams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Host stand-in for the Adafruit VL53L0X driver.  Ranges are computed from
+// the simulated machine's platform angle and carriage height (sim.cpp).
+#ifndef Adafruit_VL53L0X_h_20261017_091750_PDT
+#define Adafruit_VL53L0X_h_20261017_091750_PDT
+
+#include <stdint.h>
+
+struct VL53L0X_RangingMeasurementData_t
+{
+  uint32_t  TimeStamp       = 0;
+  uint32_t  MeasurementTimeUsec = 0;
+  uint16_t  RangeMilliMeter = 0;
+  uint16_t  RangeDMaxMilliMeter = 0;
+  uint8_t   RangeStatus     = 0;
+};
+
+using VL53L0X_Error = int8_t;
+#define VL53L0X_ERROR_NONE 0
+
+class Adafruit_VL53L0X
+{
+public:
+  auto begin(uint8_t i2c_addr = 0x29, bool debug = false) -> bool;
+  auto rangingTest(VL53L0X_RangingMeasurementData_t* data, bool debug = false)
+    -> VL53L0X_Error;
+
+  auto startRangeContinuous(uint16_t period_ms = 50) -> bool;
+  auto stopRangeContinuous()  -> void;
+  auto isRangeComplete()      -> bool;
+  auto readRange()            -> uint16_t;
+  auto readRangeStatus()      -> uint8_t;
+private:
+  bool          continuous_       = false;
+  unsigned long period_us_        = 0;
+  unsigned long next_complete_us_ = 0;
+  uint8_t       range_status_     = 0;
+};
+
+#endif//Adafruit_VL53L0X_h_20261017_091750_PDT
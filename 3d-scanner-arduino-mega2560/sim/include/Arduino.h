@@ -0,0 +1,239 @@
+/*
+MIT License
+
+Copyright (c) 2020 Robert T. Adams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Host stand-in for the subset of the Arduino core used by the firmware.
+// Only what the sketch actually touches is provided; behaviour follows the
+// AVR core closely enough for the command path to run unmodified.
+#ifndef Arduino_h_20261017_091204_PDT
+#define Arduino_h_20261017_091204_PDT
+
+#include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+#define HIGH          0x1
+#define LOW           0x0
+#define INPUT         0x0
+#define OUTPUT        0x1
+#define INPUT_PULLUP  0x2
+
+#define DEC 10
+#define HEX 16
+
+using byte = uint8_t;
+
+auto pinMode(uint8_t pin, uint8_t mode)     -> void;
+auto digitalWrite(uint8_t pin, uint8_t val) -> void;
+auto digitalRead(uint8_t pin)               -> int;
+
+auto millis()                               -> unsigned long;
+auto micros()                               -> unsigned long;
+auto delay(unsigned long ms)                -> void;
+auto delayMicroseconds(unsigned int us)     -> void;
+auto yield()                                -> void;
+
+class String
+{
+public:
+  String() = default;
+  String(const char* s) : s_(s == nullptr? "" : s) {}
+  String(char c) : s_(1, c) {}
+  String(int n) : s_(std::to_string(n)) {}
+  String(unsigned n) : s_(std::to_string(n)) {}
+  String(long n) : s_(std::to_string(n)) {}
+  String(unsigned long n) : s_(std::to_string(n)) {}
+
+  auto c_str() const  -> const char*  { return s_.c_str(); }
+  auto length() const -> unsigned     { return s_.length(); }
+  auto begin()        -> char*        { return &s_[0]; }
+  auto end()          -> char*        { return &s_[0] + s_.length(); }
+  auto begin() const  -> const char*  { return s_.c_str(); }
+  auto end() const    -> const char*  { return s_.c_str() + s_.length(); }
+
+  auto operator+=(char c)             -> String& { s_ += c; return *this; }
+  auto operator+=(const char* s)      -> String& { s_ += s; return *this; }
+  auto operator+=(const String& s)    -> String& { s_ += s.s_; return *this; }
+  auto operator==(const char* s) const   -> bool { return s_ == s; }
+  auto operator==(const String& s) const -> bool { return s_ == s.s_; }
+  auto operator!=(const char* s) const   -> bool { return s_ != s; }
+
+  auto lastIndexOf(char c) const -> int
+    {
+      auto i = s_.rfind(c);
+      return i == std::string::npos? -1 : static_cast<int>(i);
+    }
+  auto substring(unsigned from) const -> String
+    {
+      return from >= s_.length()? String() : String(s_.substr(from).c_str());
+    }
+  auto toInt() const -> long { return atol(s_.c_str()); }
+private:
+  std::string s_;
+};
+
+class Print;
+
+class Printable
+{
+public:
+  virtual ~Printable() {}
+  virtual auto printTo(Print& p) const -> size_t = 0;
+};
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual auto write(uint8_t) -> size_t = 0;
+  virtual auto write(const uint8_t* buffer, size_t size) -> size_t
+    {
+      size_t n = 0;
+      while(size--) { n += write(*buffer++); }
+      return n;
+    }
+  auto write(const char* s) -> size_t
+    {
+      return s == nullptr? 0 : write(reinterpret_cast<const uint8_t*>(s), strlen(s));
+    }
+  auto write(const char* s, size_t size) -> size_t
+    {
+      return write(reinterpret_cast<const uint8_t*>(s), size);
+    }
+
+  auto print(const char* s)         -> size_t { return write(s); }
+  auto print(const String& s)       -> size_t { return write(s.c_str(), s.length()); }
+  auto print(char c)                -> size_t { return write(static_cast<uint8_t>(c)); }
+  auto print(int n, int base = DEC)           -> size_t { return print(static_cast<long>(n), base); }
+  auto print(unsigned n, int base = DEC)      -> size_t { return print(static_cast<unsigned long>(n), base); }
+  auto print(long n, int base = DEC)          -> size_t
+    {
+      if(base == DEC && n < 0)
+      {
+        return print('-') + print(static_cast<unsigned long>(-n), base);
+      }
+      return print(static_cast<unsigned long>(n), base);
+    }
+  auto print(unsigned long n, int base = DEC) -> size_t
+    {
+      char buf[8 * sizeof(long) + 1];
+      char* p = &buf[sizeof(buf) - 1];
+      *p = '\0';
+      do
+      {
+        auto digit = static_cast<char>(n % base);
+        *--p = digit < 10? '0' + digit : 'A' + digit - 10;
+        n /= base;
+      } while(n != 0);
+      return write(p);
+    }
+  auto print(double d, int digits = 2) -> size_t
+    {
+      char buf[32];
+      snprintf(buf, sizeof(buf), "%.*f", digits, d);
+      return write(buf);
+    }
+  auto print(const Printable& p)    -> size_t { return p.printTo(*this); }
+
+  auto println()                    -> size_t { return write("\r\n"); }
+template<typename T>
+  auto println(const T& t)          -> size_t { auto n = print(t); return n + println(); }
+template<typename T>
+  auto println(const T& t, int f)   -> size_t { auto n = print(t, f); return n + println(); }
+};
+
+class Stream : public Print
+{
+public:
+  virtual auto available() -> int = 0;
+  virtual auto read()      -> int = 0;
+  virtual auto peek()      -> int = 0;
+
+  auto setTimeout(unsigned long timeout) -> void { timeout_ = timeout; }
+  auto readStringUntil(char terminator) -> String
+    {
+      String result;
+      int c;
+      while((c = timed_read()) >= 0 && c != terminator)
+      {
+        result += static_cast<char>(c);
+      }
+      return result;
+    }
+  auto readBytes(char* buffer, size_t length) -> size_t
+    {
+      size_t count = 0;
+      int c;
+      while(count < length && (c = timed_read()) >= 0)
+      {
+        buffer[count++] = static_cast<char>(c);
+      }
+      return count;
+    }
+protected:
+  unsigned long timeout_ = 1000;
+  auto timed_read() -> int
+    {
+      auto start = millis();
+      do
+      {
+        auto c = read();
+        if(c >= 0) { return c; }
+        yield();
+      } while(millis() - start < timeout_);
+      return -1;
+    }
+};
+
+// HardwareSerial's ring buffer sizes; the firmware Makefile raises both
+#ifndef SERIAL_RX_BUFFER_SIZE
+#define SERIAL_RX_BUFFER_SIZE 64
+#endif
+#ifndef SERIAL_TX_BUFFER_SIZE
+#define SERIAL_TX_BUFFER_SIZE 64
+#endif
+
+// Serial port backed by the master side of a pseudo-terminal; see sim.cpp.
+class HardwareSerial : public Stream
+{
+public:
+  auto begin(unsigned long baud) -> void;
+  auto end()                     -> void;
+  auto flush()                   -> void;
+  auto available() -> int override;
+  auto read()      -> int override;
+  auto peek()      -> int override;
+  auto availableForWrite() -> int { return SERIAL_TX_BUFFER_SIZE - 1; }
+  auto write(uint8_t c) -> size_t override;
+  auto write(const uint8_t* buffer, size_t size) -> size_t override;
+  using Print::write;
+  explicit operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif//Arduino_h_20261017_091204_PDT
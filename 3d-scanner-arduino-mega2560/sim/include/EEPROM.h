@@ -0,0 +1,64 @@
+/*
+MIT License
+
+Copyright (c) 2020 Robert T. Adams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Host stand-in for the Arduino EEPROM library: the ATmega2560's 4 KiB of
+// EEPROM, erased to 0xff.  Contents survive a watchdog reset; with the
+// simulator's --eeprom option they are also kept in a file between runs.
+#ifndef EEPROM_h_20261017_210412_PDT
+#define EEPROM_h_20261017_210412_PDT
+
+#include <stdint.h>
+
+class EEPROMClass
+{
+public:
+  auto read(int address) -> uint8_t;
+  auto write(int address, uint8_t value) -> void;
+  auto update(int address, uint8_t value) -> void;
+  auto length() -> uint16_t { return 4096; }
+
+template<typename T>
+  auto get(int address, T& t) -> T&
+    {
+      auto bytes = reinterpret_cast<uint8_t*>(&t);
+      for(unsigned i = 0; i < sizeof(T); ++i)
+      {
+        bytes[i] = read(address + i);
+      }
+      return t;
+    }
+template<typename T>
+  auto put(int address, const T& t) -> const T&
+    {
+      auto bytes = reinterpret_cast<const uint8_t*>(&t);
+      for(unsigned i = 0; i < sizeof(T); ++i)
+      {
+        update(address + i, bytes[i]);
+      }
+      return t;
+    }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif//EEPROM_h_20261017_210412_PDT
@@ -0,0 +1,43 @@
+/*
+MIT License
+
+Copyright (c) 2020 Robert T. Adams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Host stand-in for the Arduino Stepper library.  Steps are reported to the
+// simulated machine (sim.cpp) instead of driving coils.
+#ifndef Stepper_h_20261017_091512_PDT
+#define Stepper_h_20261017_091512_PDT
+
+class Stepper
+{
+public:
+  Stepper(int number_of_steps, int pin_1, int pin_2, int pin_3, int pin_4);
+
+  auto setSpeed(long rpm) -> void;
+  auto step(int steps)    -> void;
+  auto version()          -> int { return 5; }
+private:
+  int           number_of_steps_;
+  int           pin_1_;
+  unsigned long step_delay_ = 0;
+};
+
+#endif//Stepper_h_20261017_091512_PDT
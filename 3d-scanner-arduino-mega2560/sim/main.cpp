@@ -0,0 +1,99 @@
+/*
+MIT License
+
+Copyright (c) 2020 Robert T. Adams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Runs the sketch on the host against the stand-ins in include/.
+//
+//   scanner-sim [--trace] [--noise] [--eeprom FILE]
+//
+// prints the pseudo-terminal path to hand to 3dscan --port; --trace echoes
+// everything sent and received on it, --noise makes range readings noisy,
+// --eeprom keeps the EEPROM (stored configuration) in FILE across runs.
+#include "sim.hpp"
+#include "../3d-scanner-arduino-mega2560.ino"
+#include <cstring>
+#include <iostream>
+#include <new>
+
+namespace
+  {
+    // A reset starts every global on the board over.  Here the sketch's own
+    // objects are rebuilt in place, while the simulated machine (axis
+    // positions, EEPROM) carries on as the hardware would.
+    auto restart_sketch() -> void
+      {
+        control.~Control();
+        new (&control) Control();
+        Log::error()    = {};
+        Log::warning()  = {};
+        Log::info()     = {};
+        Log::debug()    = {};
+        Log::binary()   = false;
+      }
+  }
+
+int main(int argc, char* argv[])
+{
+  using namespace std;
+  try
+  {
+    for(int i = 1; i < argc; ++i)
+    {
+      if(strcmp(argv[i], "--trace") == 0)
+      {
+        sim::set_trace(true);
+      }
+      else if(strcmp(argv[i], "--noise") == 0)
+      {
+        sim::set_noise(true);
+      }
+      else if(strcmp(argv[i], "--eeprom") == 0 && i + 1 < argc)
+      {
+        sim::set_eeprom_file(argv[++i]);
+      }
+      else
+      {
+        cout << "usage: " << argv[0] << " [--trace] [--noise] [--eeprom FILE]" << endl;
+        return 1;
+      }
+    }
+    cout << "Simulated scanner serial port: " << sim::open_serial() << endl;
+    while(true)
+    {
+      try
+      {
+        setup();
+        while(true) { loop(); }
+      }
+      catch(const sim::reset&)
+      {
+        cout << "Watchdog reset" << endl;
+        restart_sketch();
+      }
+    }
+  }
+  catch(const std::exception& e)
+  {
+    cout << e.what() << endl;
+    return 1;
+  }
+}
@@ -0,0 +1,265 @@
+/*
+MIT License
+
+Copyright (c) 2020 Robert T. Adams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef reference_rcode_lexer_hpp_20261017_233518_PDT
+#define reference_rcode_lexer_hpp_20261017_233518_PDT
+
+#include "logger.hpp"
+#include "string_slice.hpp"
+#include <ctype.h>
+
+// The hand-written rcode_lexer from before the table-driven DFA, kept
+// unchanged as the reference for fuzz_lexer: the DFA must produce the same
+// token stream for any input.
+template<typename T>
+class reference_rcode_lexer
+{
+public:
+  using string_t      = T;
+  using iter_t        = const char*;
+  using char_t        = char;
+  struct token_t 
+    {
+      enum id_t 
+        { END_OF_LINE
+        , FLOAT
+        , IDENTIFIER
+        , INTEGER
+        , INVALID 
+        , OP_ASSIGN
+        , OP_MINUS
+        , SEMICOLON
+        , STRING
+        , SUFFIX
+        };
+      id_t  id      = INVALID;
+      iter_t      begin   = nullptr;
+      iter_t      end     = nullptr;
+    };
+  reference_rcode_lexer(const string_t& s)
+  : source_(s)
+  , next_(s.begin())
+  , end_(next_ + s.length())
+    {}
+
+  auto scan() -> token_t { return do_scan(); }
+  // nothing but whitespace left to scan
+  auto at_end() -> bool
+    {
+      while(next_ < end_ && isspace(*next_))
+      {
+        ++next_;
+      }
+      return next_ >= end_ || *next_ == end_of_line_char;
+    }
+  static auto get_symbol(const token_t& t) -> string_t { return do_get_symbol(t); }
+private:
+  static constexpr char_t end_of_line_char  = 0;
+  static constexpr char_t dot_char          = '.';
+  static constexpr char_t eq_char           = '=';
+  static constexpr char_t minus_char        = '-';
+  static constexpr char_t plus_char         = '+';
+  static constexpr char_t semicolon_char    = ';';
+  static constexpr char_t start_quote_char  = '"';
+  static constexpr char_t end_quote_char    = '"';
+  static constexpr char_t underscore_char   = '_';
+
+  const string_t&   source_;
+  iter_t            next_ = nullptr;
+  iter_t            end_  = nullptr;
+
+  static auto do_get_symbol(const token_t& token) -> string_t
+    {
+      return make_symbol(token.begin, token.end, static_cast<const string_t*>(nullptr));
+    }
+  // slices just point back into the source, no copy
+  static auto make_symbol(iter_t begin, iter_t end, const string_slice*) -> string_slice
+    {
+      return string_slice(begin, end);
+    }
+template<typename StringT>
+  static auto make_symbol(iter_t begin, iter_t end, const StringT*) -> StringT
+    {
+      StringT result;
+      if(begin < end)
+      { 
+        for(iter_t i = begin; i < end; ++i)
+        {
+          result += *i; 
+        }
+      }
+      return result;
+    }
+  auto do_scan() -> token_t 
+    {
+      typename token_t::id_t    token_id = token_t::INVALID;
+      iter_t                    token_begin = next_;
+      iter_t                    token_end   = next_;
+      auto accept = [&](const auto& t)
+        {
+          token_id  = t; 
+          token_end = next_;
+        };
+      auto peek = [&]
+        {
+          return next_ >= end_? end_of_line_char : *(next_);
+        };
+      auto advance = [&]
+        {
+          ++next_;
+        };
+      auto update_start = [&]
+        {
+          token_begin = next_;
+        };
+      auto skip_whitespace = [&]
+        {
+          while(isspace(peek()))
+          {
+            advance();
+          }
+          update_start();
+        };
+      auto scan_identifier = [&]
+        {
+          while
+            (  isalpha(peek()) 
+            || isdigit(peek()) 
+            || peek() == underscore_char
+            || peek() == dot_char
+            )
+          {
+            advance();
+          }
+          accept(token_t::IDENTIFIER);
+        };
+      // the token is the text between the quotes
+      auto scan_string = [&]
+        {
+          while(peek() != end_quote_char)
+          {
+            if(peek() == end_of_line_char) 
+            {
+              accept(token_t::INVALID);
+              return;
+            }
+            advance();
+          }
+          accept(token_t::STRING);
+          advance();
+        };
+      auto scan_number = [&]
+        {
+          auto consume_digits = [&]
+            {
+              while(isdigit(peek()))
+              {
+                advance();
+              }
+            };
+          auto scan_float = [&]
+            {
+              if(isdigit(peek()))
+              {
+                consume_digits();
+                accept(token_t::FLOAT);
+              }
+              else
+              {
+                accept(token_t::INVALID);
+              }
+            };
+          if(peek() == minus_char || peek() == plus_char)
+          {
+            advance();
+            if(isdigit(peek()) == false)
+            {
+              accept(token_t::OP_MINUS);
+              return;
+            }
+          }
+          consume_digits();
+          if(peek() == dot_char)
+          {
+            advance();
+            scan_float();
+          }
+          else
+          {
+            accept(token_t::INTEGER);
+          }
+        };
+      ////////////////////////
+      skip_whitespace();
+      if(isalpha(peek()))
+      {
+        advance();
+        scan_identifier();
+      }
+      else if(peek() == eq_char)
+      {
+        advance();
+        accept(token_t::OP_ASSIGN);       
+      }
+      else if(peek() == semicolon_char)
+      {
+        advance();
+        accept(token_t::SEMICOLON);
+      }
+      else if(isdigit(peek()))
+      {
+        advance();
+        scan_number();
+      }
+      else if(peek() == minus_char || peek() == plus_char)
+      {
+        advance();
+        if(isdigit(peek()))
+        {
+          scan_number();
+        }
+        else
+        {
+          accept(token_t::INVALID);
+        }
+      }
+      else if(peek() == start_quote_char)
+      {
+        advance();
+        update_start();
+        scan_string();
+      }
+      else if(peek() == end_of_line_char)
+      {
+        accept(token_t::END_OF_LINE);
+      }
+      Log::debug()
+        ( "Token contents: "
+        , static_cast<int>(token_id), ", \""
+        , string_slice(token_begin, token_end), "\""
+        );
+      return token_t { token_id, token_begin, token_end };
+    }
+};
+
+#endif//reference_rcode_lexer_hpp_20261017_233518_PDT
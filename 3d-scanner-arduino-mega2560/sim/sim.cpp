@@ -0,0 +1,473 @@
+/*
+MIT License
+
+Copyright (c) 2020 Robert T. Adams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Simulated scanner: a host implementation of the Arduino core, Stepper,
+// VL53L0X, EEPROM and watchdog stand-ins in include/.  The serial port is the
+// master side of a pseudo-terminal, so the real client can connect to the
+// slave path printed at startup.  Stepper motion and ranging advance a virtual clock
+// instead of sleeping, so the firmware runs at full host speed.
+#include "sim.hpp"
+#include <Arduino.h>
+#include <Stepper.h>
+#include <Adafruit_VL53L0X.h>
+#include <EEPROM.h>
+#include <avr/wdt.h>
+#include <chrono>
+#include <cmath>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <poll.h>
+#include <random>
+#include <stdexcept>
+#include <termios.h>
+#include <unistd.h>
+
+HardwareSerial Serial;
+EEPROMClass    EEPROM;
+
+namespace 
+  {
+    // pins as wired in control.hpp
+    constexpr int platform_pin_1_           = 2;
+    constexpr int carriage_pin_1_           = 6;
+    constexpr int platform_standby_pin_     = 23;
+    constexpr int carriage_standby_pin_     = 25;
+    constexpr int limit_switch_min_         = 27;
+    constexpr int limit_switch_max_         = 29;
+    // machine geometry; see control.cpp
+    constexpr int    steps_per_turn_        = 200;
+    constexpr double screw_travel_per_turn_ = 8.0;
+    constexpr double carriage_travel_mm_    = 200.0;
+    constexpr long   carriage_max_steps_    = 
+      static_cast<long>(carriage_travel_mm_ / screw_travel_per_turn_ * steps_per_turn_);
+    // scanned object: a lobed column centred on the platform axis
+    constexpr double sensor_to_axis_mm_     = 150.0;
+    constexpr double object_radius_mm_      = 50.0;
+    constexpr double object_lobe_mm_        = 12.0;
+    constexpr double object_height_mm_      = 160.0;
+    // with noise enabled: gaussian range error and spurious phase failures
+    constexpr double range_noise_sd_mm_     = 3.0;
+    constexpr double range_failure_rate_    = 0.03;
+    constexpr unsigned long ranging_time_us_ = 33000;
+    constexpr unsigned long ranging_poll_us_ = 1000;
+    // time a pass through a firmware wait loop is taken to cost
+    constexpr unsigned long yield_time_us_   = 100;
+    // serial idle handling
+    constexpr int   idle_polls_before_sleep_ = 64;
+    constexpr int   idle_sleep_ms_           = 1;
+
+    struct Machine
+      {
+        long          platform_steps  = 0;
+        long          carriage_steps  = carriage_max_steps_ / 4;
+        bool          platform_awake  = false;  // driver STBY pins high
+        bool          carriage_awake  = false;
+        unsigned long clock_offset_us = 0;
+        int           master_fd       = -1;
+        int           slave_fd        = -1;
+        int           peeked          = -1;
+        int           idle_polls      = 0;
+        bool          trace           = false;
+        bool          noise           = false;
+        std::mt19937  random;
+        uint8_t       eeprom[4096];
+        std::string   eeprom_path;    // backing file, if any
+        Machine()
+          {
+            memset(eeprom, 0xff, sizeof(eeprom));
+          }
+      };
+    auto machine() -> Machine&
+      {
+        static Machine m;
+        return m;
+      }
+    auto real_micros() -> unsigned long
+      {
+        using namespace std::chrono;
+        static const auto start = steady_clock::now();
+        return duration_cast<microseconds>(steady_clock::now() - start).count();
+      }
+    // the machine did something, so don't sleep on the next idle serial poll
+    auto advance_clock(unsigned long us) -> void
+      {
+        machine().clock_offset_us += us;
+        machine().idle_polls       = 0;
+      }
+    auto fill_peek() -> void
+      {
+        auto& m = machine();
+        if(m.peeked != -1 || m.master_fd == -1)
+        {
+          return;
+        }
+        pollfd pfd { m.master_fd, POLLIN, 0 };
+        auto timeout = m.idle_polls >= idle_polls_before_sleep_? idle_sleep_ms_ : 0;
+        if(poll(&pfd, 1, timeout) > 0 && (pfd.revents & POLLIN))
+        {
+          unsigned char c;
+          if(::read(m.master_fd, &c, 1) == 1)
+          {
+            m.peeked      = c;
+            m.idle_polls  = 0;
+            if(m.trace)
+            {
+              std::cout << c << std::flush;
+            }
+            return;
+          }
+        }
+        ++m.idle_polls;
+      }
+    auto object_range_mm() -> VL53L0X_RangingMeasurementData_t
+      {
+        auto& m = machine();
+        VL53L0X_RangingMeasurementData_t result;
+        auto height = m.carriage_steps * screw_travel_per_turn_ / steps_per_turn_;
+        auto angle  = 2.0 * M_PI * m.platform_steps / steps_per_turn_;
+        if(height > object_height_mm_)
+        {
+          result.RangeStatus      = 4;
+          result.RangeMilliMeter  = 8190;
+          return result;
+        }
+        auto taper  = 1.0 - 0.25 * height / object_height_mm_;
+        auto radius = taper * (object_radius_mm_ + object_lobe_mm_ * std::cos(3.0 * angle));
+        auto range  = sensor_to_axis_mm_ - radius;
+        result.RangeStatus      = 0;
+        if(m.noise)
+        {
+          range += std::normal_distribution<double>(0.0, range_noise_sd_mm_)(m.random);
+          if(std::bernoulli_distribution(range_failure_rate_)(m.random))
+          {
+            result.RangeStatus  = 4;
+            range               = 8190;
+          }
+        }
+        result.RangeMilliMeter  = static_cast<uint16_t>(std::lround(range));
+        return result;
+      }
+  }
+
+namespace sim
+  {
+    auto open_serial() -> const char*
+      {
+        auto& m = machine();
+        m.master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+        if(m.master_fd == -1 || grantpt(m.master_fd) != 0 || unlockpt(m.master_fd) != 0)
+        {
+          throw std::runtime_error("Could not allocate pseudo-terminal");
+        }
+        auto path = ptsname(m.master_fd);
+        // hold the slave open so the master survives client disconnects, and
+        // put it in raw mode so the line discipline doesn't echo commands back
+        m.slave_fd = open(path, O_RDWR | O_NOCTTY);
+        termios options;
+        if(m.slave_fd == -1 || tcgetattr(m.slave_fd, &options) != 0)
+        {
+          throw std::runtime_error("Could not configure pseudo-terminal");
+        }
+        cfmakeraw(&options);
+        tcsetattr(m.slave_fd, TCSANOW, &options);
+        fcntl(m.master_fd, F_SETFL, fcntl(m.master_fd, F_GETFL) | O_NONBLOCK);
+        return path;
+      }
+    auto set_trace(bool enabled) -> void
+      {
+        machine().trace = enabled;
+      }
+    auto set_noise(bool enabled) -> void
+      {
+        machine().noise = enabled;
+      }
+    auto set_eeprom_file(const char* path) -> void
+      {
+        auto& m = machine();
+        m.eeprom_path = path;
+        std::ifstream in(path, std::ios::binary);
+        if(in)
+        {
+          in.read(reinterpret_cast<char*>(m.eeprom), sizeof(m.eeprom));
+          return;
+        }
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(m.eeprom), sizeof(m.eeprom));
+        if(!out)
+        {
+          throw std::runtime_error(std::string("Could not create EEPROM file ") + path);
+        }
+      }
+    auto step_motor(int pin_1, int steps, unsigned long step_delay_us) -> void
+      {
+        auto& m = machine();
+        // a driver in standby leaves its coils unpowered: the step is lost
+        if(pin_1 == platform_pin_1_ && m.platform_awake)
+        {
+          m.platform_steps += steps;
+        }
+        else if(pin_1 == carriage_pin_1_ && m.carriage_awake)
+        {
+          m.carriage_steps += steps;
+        }
+        advance_clock(static_cast<unsigned long>(std::abs(steps)) * step_delay_us);
+      }
+  }
+
+//============================================================================
+// Arduino core
+//============================================================================
+auto pinMode(uint8_t, uint8_t) -> void
+  {
+  }
+auto digitalWrite(uint8_t pin, uint8_t value) -> void
+  {
+    auto& m = machine();
+    if(pin == platform_standby_pin_)
+    {
+      m.platform_awake = value == HIGH;
+    }
+    else if(pin == carriage_standby_pin_)
+    {
+      m.carriage_awake = value == HIGH;
+    }
+  }
+auto digitalRead(uint8_t pin) -> int
+  {
+    auto& m = machine();
+    if(pin == limit_switch_min_)
+    {
+      return m.carriage_steps <= 0? LOW : HIGH;
+    }
+    if(pin == limit_switch_max_)
+    {
+      return m.carriage_steps >= carriage_max_steps_? LOW : HIGH;
+    }
+    if(pin == platform_standby_pin_)
+    {
+      return m.platform_awake? HIGH : LOW;
+    }
+    if(pin == carriage_standby_pin_)
+    {
+      return m.carriage_awake? HIGH : LOW;
+    }
+    return LOW;
+  }
+auto micros() -> unsigned long
+  {
+    return real_micros() + machine().clock_offset_us;
+  }
+auto millis() -> unsigned long
+  {
+    return micros() / 1000;
+  }
+auto delay(unsigned long ms) -> void
+  {
+    advance_clock(ms * 1000);
+  }
+auto delayMicroseconds(unsigned int us) -> void
+  {
+    advance_clock(us);
+  }
+// wait loops on the board spin in real time; here they move the virtual
+// clock along (without counting as activity, so an idle sketch still sleeps)
+auto yield() -> void
+  {
+    machine().clock_offset_us += yield_time_us_;
+    fill_peek();
+  }
+auto HardwareSerial::begin(unsigned long) -> void
+  {
+  }
+auto HardwareSerial::end() -> void
+  {
+  }
+auto HardwareSerial::flush() -> void
+  {
+    auto fd = machine().slave_fd;
+    if(fd != -1)
+    {
+      tcdrain(fd);
+    }
+  }
+auto HardwareSerial::available() -> int
+  {
+    fill_peek();
+    return machine().peeked == -1? 0 : 1;
+  }
+auto HardwareSerial::peek() -> int
+  {
+    fill_peek();
+    return machine().peeked;
+  }
+auto HardwareSerial::read() -> int
+  {
+    fill_peek();
+    auto c = machine().peeked;
+    machine().peeked = -1;
+    return c;
+  }
+auto HardwareSerial::write(uint8_t c) -> size_t
+  {
+    return write(&c, 1);
+  }
+auto HardwareSerial::write(const uint8_t* buffer, size_t size) -> size_t
+  {
+    auto fd = machine().master_fd;
+    if(machine().trace)
+    {
+      std::cout.write(reinterpret_cast<const char*>(buffer), size).flush();
+    }
+    size_t written = 0;
+    while(fd != -1 && written < size)
+    {
+      auto n = ::write(fd, buffer + written, size - written);
+      if(n > 0)
+      {
+        written += n;
+      }
+      else
+      {
+        pollfd pfd { fd, POLLOUT, idle_sleep_ms_ };
+        poll(&pfd, 1, idle_sleep_ms_);
+      }
+    }
+    return size;
+  }
+//============================================================================
+// libraries
+//============================================================================
+Stepper::Stepper(int number_of_steps, int pin_1, int, int, int)
+: number_of_steps_(number_of_steps)
+, pin_1_(pin_1)
+  {
+  }
+auto Stepper::setSpeed(long rpm) -> void
+  {
+    step_delay_ = 60L * 1000L * 1000L / number_of_steps_ / rpm;
+  }
+auto Stepper::step(int steps) -> void
+  {
+    sim::step_motor(pin_1_, steps, step_delay_);
+  }
+auto Adafruit_VL53L0X::begin(uint8_t, bool) -> bool
+  {
+    return true;
+  }
+auto Adafruit_VL53L0X::rangingTest(VL53L0X_RangingMeasurementData_t* data, bool)
+  -> VL53L0X_Error
+  {
+    advance_clock(ranging_time_us_);
+    *data = object_range_mm();
+    return VL53L0X_ERROR_NONE;
+  }
+auto Adafruit_VL53L0X::startRangeContinuous(uint16_t period_ms) -> bool
+  {
+    continuous_       = true;
+    period_us_        = period_ms * 1000UL > ranging_time_us_? period_ms * 1000UL : ranging_time_us_;
+    next_complete_us_ = micros() + period_us_;
+    return true;
+  }
+auto Adafruit_VL53L0X::stopRangeContinuous() -> void
+  {
+    continuous_ = false;
+  }
+// measurements complete every period_us_ whether or not they are read; a
+// poll that finds none ready lets a little virtual time pass, so busy-waits
+// finish at host speed
+auto Adafruit_VL53L0X::isRangeComplete() -> bool
+  {
+    if(continuous_ == false)
+    {
+      return false;
+    }
+    auto now = micros();
+    if(static_cast<long>(now - next_complete_us_) >= 0)
+    {
+      return true;
+    }
+    auto remaining = next_complete_us_ - now;
+    advance_clock(remaining < ranging_poll_us_? remaining : ranging_poll_us_);
+    return false;
+  }
+auto Adafruit_VL53L0X::readRange() -> uint16_t
+  {
+    auto measure  = object_range_mm();
+    range_status_ = measure.RangeStatus;
+    auto now      = micros();
+    while(static_cast<long>(now - next_complete_us_) >= 0)
+    {
+      next_complete_us_ += period_us_;
+    }
+    return measure.RangeStatus == 4? 0xffff : measure.RangeMilliMeter;
+  }
+auto Adafruit_VL53L0X::readRangeStatus() -> uint8_t
+  {
+    return range_status_;
+  }
+//============================================================================
+// EEPROM
+//============================================================================
+auto EEPROMClass::read(int address) -> uint8_t
+  {
+    auto& m = machine();
+    return address >= 0 && address < length()? m.eeprom[address] : 0xff;
+  }
+auto EEPROMClass::write(int address, uint8_t value) -> void
+  {
+    auto& m = machine();
+    if(address < 0 || address >= length())
+    {
+      return;
+    }
+    m.eeprom[address] = value;
+    if(!m.eeprom_path.empty())
+    {
+      std::fstream file(m.eeprom_path, std::ios::in | std::ios::out | std::ios::binary);
+      file.seekp(address);
+      file.put(static_cast<char>(value));
+    }
+    // an EEPROM cell write takes 3.3 ms on the ATmega2560
+    advance_clock(3300);
+  }
+auto EEPROMClass::update(int address, uint8_t value) -> void
+  {
+    if(read(address) != value)
+    {
+      write(address, value);
+    }
+  }
+//============================================================================
+// watchdog
+//============================================================================
+auto wdt_enable(int) -> void
+  {
+    throw sim::reset();
+  }
+auto wdt_disable() -> void
+  {
+  }
+auto wdt_reset() -> void
+  {
+  }
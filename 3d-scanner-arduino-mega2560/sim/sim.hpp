@@ -0,0 +1,46 @@
+/*
+MIT License
+
+Copyright (c) 2020 Robert T. Adams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef sim_hpp_20261017_092201_PDT
+#define sim_hpp_20261017_092201_PDT
+
+namespace sim
+  {
+    // thrown by wdt_enable(); unwinds the sketch back to main(), which
+    // rebuilds its globals and restarts it from setup()
+    struct reset {};
+
+    // allocate the pseudo-terminal standing in for Serial; returns the path
+    // of the slave side for the client to open
+    auto open_serial() -> const char*;
+    // copy all serial traffic, both directions, to stdout
+    auto set_trace(bool enabled) -> void;
+    // add VL53L0X-like measurement noise and occasional failed readings
+    auto set_noise(bool enabled) -> void;
+    // keep the EEPROM's contents in the file at path, creating it if needed
+    auto set_eeprom_file(const char* path) -> void;
+    // move the simulated machine's axis driven from pin_1
+    auto step_motor(int pin_1, int steps, unsigned long step_delay_us) -> void;
+  }
+
+#endif//sim_hpp_20261017_092201_PDT
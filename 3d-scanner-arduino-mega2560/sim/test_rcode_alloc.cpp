@@ -0,0 +1,107 @@
+/*
+MIT License
+
+Copyright (c) 2020 Robert T. Adams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Counts heap allocations per parsed command line.  Control parses with
+// RCode<string_slice> over its line buffer, which must not allocate at all;
+// RCode<String>, what it used before, is counted alongside for comparison;
+// the sim's String is a std::string, whose small-string buffer hides the
+// short names and values that allocate on the board.
+#include "rcode.hpp"
+#include "string_slice.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+namespace
+  {
+    size_t allocations_ = 0;
+
+    const char* const lines_[] =
+      { "platform.speed"
+      , "platform.speed=42"
+      , "carriage.accel=1.25"
+      , "platform.move.steps=-200;carriage.move.steps=50"
+      , "macro.define=\"platform.move.steps=1;scan.run\""
+      , "scan.layers=12 ; scan.run"
+      , "platform.speed=5-3"
+      , "carriage.max=\"unterminated"
+      , "   "
+      };
+
+    // parses every statement of line, as Control::for_each_statement does,
+    // and returns the allocations made
+template<typename StringT>
+    auto count_allocations(const char* line) -> size_t
+      {
+        using rcode_t = RCode<StringT>;
+        auto source = StringT(line);
+        auto before = allocations_;
+        auto lexer  = typename rcode_t::lexer_t(source);
+        while(lexer.at_end() == false)
+        {
+          auto rcode = rcode_t::parse(lexer);
+          if(rcode.error() != rcode_t::Error::ok)
+          {
+            break;
+          }
+        }
+        return allocations_ - before;
+      }
+  }
+
+auto operator new(size_t size) -> void*
+{
+  ++allocations_;
+  if(auto p = std::malloc(size > 0? size : 1))
+  {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+auto operator delete(void* p) noexcept -> void
+{
+  std::free(p);
+}
+auto operator delete(void* p, size_t) noexcept -> void
+{
+  std::free(p);
+}
+
+int main()
+{
+  using namespace std;
+  auto failed = false;
+  for(auto line : lines_)
+  {
+    auto slice_count  = count_allocations<string_slice>(line);
+    auto string_count = count_allocations<String>(line);
+    cout << slice_count << " (String: " << string_count << ")  " << line << endl;
+    failed = failed || slice_count != 0;
+  }
+  if(failed)
+  {
+    cout << "FAILED: parsing into string_slices allocated" << endl;
+    return 1;
+  }
+  return 0;
+}
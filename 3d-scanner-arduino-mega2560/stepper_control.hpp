@@ -27,6 +27,16 @@ SOFTWARE.
 #include "logger.hpp"
 #include <Stepper.h>
 #include <Arduino.h>
+// Poll-driven motion: move() only sets a target, and each call to run()
+// takes at most one step once the step interval for the current speed has
+// elapsed.  The Stepper library is still used to sequence the coils, but with
+// its own delay set to the minimum so it never blocks.
+//
+// With a trapezoid or S-curve profile, moves ramp up from rest and back down
+// into the target.  The step intervals for the ramp are computed once, when
+// the speed or profile changes, into a table sampled along the ramp (densely
+// near standstill, where speed changes fastest); run() walks a cursor through
+// it by the distance from the nearer end of the move.
 template
   < class T 
   , int STEPS
@@ -41,6 +51,7 @@ class StepperControl
 public:
   using stepper_t   = T;
   using pin_value_t = decltype(HIGH);
+  enum class Profile : uint8_t { constant, trapezoid, s_curve };
   StepperControl()
     : stepper_(STEPS, CA1, CA2, CB1, CB2)
   {
@@ -50,22 +61,91 @@ public:
     {
       pinMode(STBY, OUTPUT);
       standby();
+      stepper_.setSpeed(unlimited_rpm_);
     }
   static constexpr auto steps_per_revolution() -> auto { return STEPS; }
 
+  // speed in revolutions per minute; takes effect on the next step
   auto set_speed(int s) -> void 
     { 
-      speed_ = s;
-      stepper_.setSpeed(speed_); 
+      if(s == speed_)
+      {
+        return;
+      }
+      speed_            = s;
+      step_interval_us_ = us_per_minute_ / STEPS / speed_;
+      build_ramp();
+    }
+  // acceleration in steps/s^2; ignored by Profile::constant
+  auto set_profile(Profile p, long acceleration) -> void
+    {
+      profile_      = p;
+      acceleration_ = acceleration;
+      build_ramp();
     }
 
   auto speed() const -> const int { return speed_; }
-  auto step(int n) -> void 
+  // start moving n steps from the current target and return immediately
+  auto move(long n) -> void
+    {
+      if(is_moving() == false)
+      {
+        steps_taken_ = 0;
+      }
+      target_ += n;
+    }
+  auto stop() -> void
+    {
+      target_ = position_;
+    }
+  // drop to standby once the current move completes
+  auto release_when_idle() -> void
+    {
+      release_when_idle_ = true;
+    }
+  // call as often as possible; returns true while a move is in progress
+  auto run() -> bool
+    {
+      if(position_ == target_)
+      {
+        if(release_when_idle_)
+        {
+          release_when_idle_ = false;
+          standby();
+        }
+        return false;
+      }
+      auto now       = micros();
+      auto remaining = target_ > position_? target_ - position_ : position_ - target_;
+      auto from_end  = steps_taken_ < remaining? steps_taken_ : remaining - 1;
+      if(now - last_step_us_ >= ramp_interval(from_end))
+      {
+        auto d = direction();
+        stepper_.step(d);
+        position_    += d;
+        last_step_us_ = now;
+        ++steps_taken_;
+      }
+      return true;
+    }
+  auto is_moving() const -> bool { return position_ != target_; }
+  // -1, 0 or 1
+  auto direction() const -> int 
     { 
-      stepper_.step(n); 
+      return target_ > position_? 1 : (target_ < position_? -1 : 0); 
+    }
+  // steps moved since the last set_position()
+  auto position() const -> long { return position_; }
+  auto set_position(long p) -> void
+    {
+      position_           = p;
+      target_             = p;
+      release_when_idle_  = false;
     }
+  // overrides a release_when_idle() still pending from an earlier move
   auto set_standby(pin_value_t pv) -> void 
   { 
+    release_when_idle_ = false;
     digitalWrite(STBY, pv); 
   }
   auto standby() -> void 
@@ -78,8 +158,98 @@ public:
   }
   auto stepper_inactive() -> bool { return digitalRead(STBY) == LOW; }
 private:
-  stepper_t stepper_;
-  int       speed_ = 0;
+  static constexpr unsigned long us_per_minute_ = 60UL * 1000UL * 1000UL;
+  // makes Stepper's own step delay 1 us
+  static constexpr long          unlimited_rpm_ = us_per_minute_ / STEPS;
+  static constexpr int           ramp_table_size_ = 32;
+  static constexpr unsigned long max_ramp_interval_us_ = 0xffff;
+
+  stepper_t     stepper_;
+  int           speed_              = 0;
+  long          position_           = 0;
+  long          target_             = 0;
+  unsigned long step_interval_us_   = 0;
+  unsigned long last_step_us_       = 0;
+  bool          release_when_idle_  = false;
+  long          steps_taken_        = 0;
+  Profile       profile_            = Profile::constant;
+  long          acceleration_       = 0;
+  // steps ramp_step_[i] up to ramp_step_[i + 1] of the ramp are taken at
+  // ramp_us_[i]; past ramp_steps_ the move runs at step_interval_us_
+  long          ramp_steps_         = 0;
+  uint16_t      ramp_step_[ramp_table_size_];
+  uint16_t      ramp_us_[ramp_table_size_];
+  int           ramp_cursor_        = 0;
+
+  // steps_from_end only changes by one per step, so the cursor rarely moves
+  // more than one entry
+  auto ramp_interval(long steps_from_end) -> unsigned long
+    {
+      if(steps_from_end >= ramp_steps_)
+      {
+        return step_interval_us_;
+      }
+      while(ramp_cursor_ + 1 < ramp_table_size_ && ramp_step_[ramp_cursor_ + 1] <= steps_from_end)
+      {
+        ++ramp_cursor_;
+      }
+      while(ramp_cursor_ > 0 && ramp_step_[ramp_cursor_] > steps_from_end)
+      {
+        --ramp_cursor_;
+      }
+      return ramp_us_[ramp_cursor_];
+    }
+  auto build_ramp() -> void
+    {
+      ramp_steps_   = 0;
+      ramp_cursor_  = 0;
+      if(profile_ == Profile::constant || acceleration_ <= 0 || speed_ <= 0)
+      {
+        return;
+      }
+      const float top_speed   = 1e6f / step_interval_us_;
+      const float start_speed = sqrtf(2.0f * acceleration_);
+      // the S-curve follows speed = top_speed * (3u^2 - 2u^3) for u = t / T
+      // over T = 1.5 * top_speed / acceleration, so its peak acceleration
+      // matches the trapezoid's and it covers 1.5x the distance
+      const float s_curve_time = 1.5f * top_speed / acceleration_;
+      float ramp = top_speed * top_speed / (2.0f * acceleration_);
+      if(profile_ == Profile::s_curve)
+      {
+        ramp *= 1.5f;
+      }
+      ramp = ramp > 0xffff? 0xffff : ramp;
+      ramp_steps_ = ramp < 1.0f? 1 : static_cast<long>(ramp);
+      for(int i = 0; i < ramp_table_size_; ++i)
+      {
+        // quadratic spacing: speed grows roughly with sqrt(step)
+        const float f     = static_cast<float>(i) / ramp_table_size_;
+        const long  step  = static_cast<long>(ramp_steps_ * f * f);
+        ramp_step_[i]     = static_cast<uint16_t>(step);
+        float       speed = 0;
+        if(profile_ == Profile::trapezoid)
+        {
+          speed = sqrtf(2.0f * acceleration_ * (step + 1));
+        }
+        else
+        {
+          // distance covered by time u is top_speed * T * (u^3 - u^4 / 2);
+          // bisect for the u at which step + 1 steps have been taken
+          float lo = 0.0f;
+          float hi = 1.0f;
+          for(int n = 0; n < 16; ++n)
+          {
+            const float u = (lo + hi) / 2.0f;
+            const float distance = top_speed * s_curve_time * (u * u * u - u * u * u * u / 2.0f);
+            (distance < step + 1? lo : hi) = u;
+          }
+          speed = top_speed * lo * lo * (3.0f - 2.0f * lo);
+        }
+        speed = speed < start_speed? start_speed : (speed > top_speed? top_speed : speed);
+        auto interval = static_cast<unsigned long>(1e6f / speed);
+        ramp_us_[i] = interval > max_ramp_interval_us_? max_ramp_interval_us_ : interval;
+      }
+    }
 };
 
 #endif//stepper_control_hpp_20200611_174745_PDT
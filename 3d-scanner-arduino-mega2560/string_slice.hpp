@@ -0,0 +1,92 @@
+/*
+MIT License
+
+Copyright (c) 2020 Robert T. Adams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef string_slice_hpp_20261017_101937_PDT
+#define string_slice_hpp_20261017_101937_PDT
+
+#include <stddef.h>
+#include <string.h>
+#include <Arduino.h>
+
+// Non-owning (pointer, length) view of characters held elsewhere, normally
+// Control's line buffer.  Mirrors the parts of Arduino's String interface that
+// the rcode handlers use, so parsing a command never touches the heap.
+class string_slice : public Printable
+{
+public:
+  using iter_t = const char*;
+
+  string_slice() = default;
+  string_slice(const char* s)
+  : begin_(s)
+  , length_(strlen(s))
+    {
+    }
+  string_slice(iter_t b, iter_t e)
+  : begin_(b)
+  , length_(e > b? static_cast<size_t>(e - b) : 0)
+    {
+    }
+
+  auto begin() const  -> iter_t { return begin_;           }
+  auto end() const    -> iter_t { return begin_ + length_; }
+  auto length() const -> size_t { return length_;          }
+
+  auto operator==(const char* s) const -> bool
+    {
+      return strncmp(begin_, s, length_) == 0 && s[length_] == '\0';
+    }
+  auto operator==(const string_slice& s) const -> bool
+    {
+      return length_ == s.length_ && strncmp(begin_, s.begin_, length_) == 0;
+    }
+  auto operator!=(const char* s) const -> bool
+    {
+      return (*this == s) == false;
+    }
+  auto lastIndexOf(char c) const -> int
+    {
+      for(auto i = static_cast<int>(length_) - 1; i >= 0; --i)
+      {
+        if(begin_[i] == c)
+        {
+          return i;
+        }
+      }
+      return -1;
+    }
+  auto substring(size_t from) const -> string_slice
+    {
+      return from >= length_? string_slice(end(), end()) : string_slice(begin_ + from, end());
+    }
+
+  auto printTo(Print& p) const -> size_t override
+    {
+      return p.write(reinterpret_cast<const uint8_t*>(begin_), length_);
+    }
+private:
+  iter_t  begin_  = "";
+  size_t  length_ = 0;
+};
+
+#endif//string_slice_hpp_20261017_101937_PDT
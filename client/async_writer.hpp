@@ -0,0 +1,135 @@
+#ifndef async_writer_hpp_20261017_184410_PDT
+#define async_writer_hpp_20261017_184410_PDT
+
+#include "spsc_queue.hpp"
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+// Output stage of the capture pipeline.  Text and binary written to stream()
+// is cut into blocks and handed to a writer thread, so a slow disk stalls
+// only that thread.  Flushing stream() sends the partial block on and the
+// writer flushes the destination after every block, which keeps incremental
+// output (the OBJ mesher's rings) visible on disk.
+//
+// stream() belongs to one thread at a time; close() (or the destructor)
+// waits until everything written has reached the destination.  If the
+// destination failed (a full disk), close() throws; the destructor, which
+// cannot, only waits.
+class AsyncWriter
+{
+public:
+  static constexpr size_t block_size_ = 64 * 1024;
+
+  explicit AsyncWriter(std::ostream& out)
+  : out_(out)
+  , buffer_(*this)
+  , stream_(&buffer_)
+    {
+      thread_ = std::thread([this] { run(); });
+    }
+  AsyncWriter(const AsyncWriter&) = delete;
+  auto operator=(const AsyncWriter&) -> AsyncWriter& = delete;
+  ~AsyncWriter()
+    {
+      join();
+    }
+
+  auto stream() -> std::ostream& { return stream_; }
+  auto close() -> void
+    {
+      join();
+      if(failed_.load())
+      {
+        throw std::runtime_error("Could not write the output");
+      }
+    }
+  auto stats() const -> QueueStats { return blocks_.stats(); }
+private:
+  using block_t = std::vector<char>;
+
+  class Buffer : public std::streambuf
+  {
+  public:
+    explicit Buffer(AsyncWriter& w)
+    : writer_(w)
+      {
+        reset();
+      }
+  protected:
+    auto overflow(int_type c) -> int_type override
+      {
+        send();
+        if(!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+          *pptr() = traits_type::to_char_type(c);
+          pbump(1);
+        }
+        return traits_type::not_eof(c);
+      }
+    auto sync() -> int override
+      {
+        send();
+        return 0;
+      }
+  private:
+    AsyncWriter&  writer_;
+    block_t       block_;
+
+    auto reset() -> void
+      {
+        block_.resize(block_size_);
+        setp(block_.data(), block_.data() + block_.size());
+      }
+    auto send() -> void
+      {
+        if(pptr() != pbase())
+        {
+          block_.resize(pptr() - pbase());
+          writer_.blocks_.push(std::move(block_));
+          block_ = block_t();
+          reset();
+        }
+      }
+  };
+
+  std::ostream&           out_;
+  SpscQueue<block_t, 64>  blocks_;
+  Buffer                  buffer_;
+  std::ostream            stream_;
+  std::thread             thread_;
+  std::atomic<bool>       failed_ {false};
+
+  auto join() -> void
+    {
+      if(thread_.joinable())
+      {
+        stream_.flush();
+        blocks_.close();
+        thread_.join();
+      }
+    }
+  // after a failure the blocks are still taken, so the producer never waits
+  auto run() -> void
+    {
+      block_t block;
+      while(!blocks_.drained())
+      {
+        if(blocks_.pop(block, std::chrono::milliseconds(100)) && !failed_.load())
+        {
+          out_.write(block.data(), block.size());
+          out_.flush();
+          if(!out_)
+          {
+            failed_.store(true);
+          }
+        }
+      }
+    }
+};
+
+#endif//async_writer_hpp_20261017_184410_PDT
@@ -0,0 +1,251 @@
+// Throughput of the receive path 3dscan uses, from read(2) on a tty through
+// CommandChannel's reader thread, input queue and StreamDecoder to the frame
+// and line callbacks, with a pseudo-terminal standing in for the scanner.
+//
+//   bench-ingest [SAMPLES]
+//
+// A thread plays the scanner: it answers the channel's system.sync, then
+// writes a binary scan into the pty: each layer is a "#layer" marker, a
+// binary log record, then a revolution of sample frames.  Reports
+// bytes/s, samples/s and heap allocations per sample on the reading side, and
+// the same for the stream decoded straight from memory, which leaves out the
+// cost of the tty itself.
+#include "command_channel.hpp"
+#include "input_buffer.hpp"
+#include "serial_port.hpp"
+#include "stream_decoder.hpp"
+#include <pty.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+  {
+    std::atomic<size_t> allocations_ {0};
+
+    constexpr int platform_steps_ = 200;
+
+    auto make_stream(size_t samples) -> std::vector<uint8_t>
+      {
+        std::vector<uint8_t> out;
+        size_t sequence = 0;
+        for(int16_t layer = 0; sequence < samples; ++layer)
+        {
+          auto marker = "#layer " + std::to_string(layer) + "\r\n";
+          out.insert(out.end(), marker.begin(), marker.end());
+          LogRecord record;
+          record.level      = 3;
+          record.message    = LogMessage::scanning_layer;
+          record.arg_count  = 1;
+          record.args[0]    = layer;
+          uint8_t encoded[LogRecord::max_size_];
+          out.insert(out.end(), encoded, encoded + record.encode(encoded));
+          for(int16_t step = 0; step < platform_steps_ && sequence < samples; ++step)
+          {
+            ScanFrame f;
+            f.sequence          = static_cast<uint16_t>(sequence++);
+            f.platform_step     = step;
+            f.carriage_position = layer;
+            f.range_mm          = static_cast<uint16_t>(100 + step % 37);
+            uint8_t frame[ScanFrame::size_];
+            f.encode(frame);
+            out.insert(out.end(), frame, frame + ScanFrame::size_);
+          }
+        }
+        return out;
+      }
+
+    struct Counts
+    {
+      size_t  bytes       = 0;
+      size_t  frames      = 0;
+      size_t  lines       = 0;
+      size_t  bad_frames  = 0;
+      size_t  allocations = 0;
+      double  seconds     = 0;
+    };
+
+    // runs read(in) until it returns 0, decoding after each call
+template<typename ReadF>
+    auto decode_all(ReadF&& read) -> Counts
+      {
+        using clock = std::chrono::steady_clock;
+        Counts counts;
+        long checksum = 0;
+        StreamDecoder decoder(
+          [&](const ScanFrame& f) { ++counts.frames; checksum += f.range_mm; },
+          [&](std::string_view line) { ++counts.lines; checksum += static_cast<long>(line.size()); }
+        );
+        InputBuffer in;
+        auto allocations  = allocations_.load();
+        auto start        = clock::now();
+        size_t n;
+        while((n = read(in)) > 0)
+        {
+          counts.bytes += n;
+          decoder.decode(in);
+        }
+        std::chrono::duration<double> elapsed = clock::now() - start;
+        counts.seconds      = elapsed.count();
+        counts.allocations  = allocations_.load() - allocations;
+        counts.bad_frames   = decoder.bad_frames();
+        return counts;
+      }
+    auto from_memory(const std::vector<uint8_t>& stream) -> Counts
+      {
+        size_t done = 0;
+        return decode_all([&](InputBuffer& in)
+          {
+            auto n = std::min(in.space(), stream.size() - done);
+            std::copy_n(stream.data() + done, n, in.tail());
+            in.commit(n);
+            done += n;
+            return n;
+          });
+      }
+    // Plays the scanner's side of a pty: answers the channel's first
+    // system.sync, then, once go is set, writes the stream.
+    auto play_scanner(int master, const std::vector<uint8_t>& stream, const std::atomic<bool>& go) -> void
+      {
+        std::string heard;
+        char buffer[256];
+        const std::string sync = "system.sync=";
+        size_t at;
+        while((at = heard.find(sync)) == std::string::npos || heard.find('\n', at) == std::string::npos)
+        {
+          auto n = ::read(master, buffer, sizeof buffer);
+          if(n <= 0)
+          {
+            return;
+          }
+          heard.append(buffer, static_cast<size_t>(n));
+        }
+        auto token  = heard.substr(at + sync.size(), heard.find('\n', at) - at - sync.size());
+        auto answer = "#sync " + token + "\r\nREADY\r\n";
+        if(::write(master, answer.data(), answer.size()) != static_cast<ssize_t>(answer.size()))
+        {
+          return;
+        }
+        while(!go.load())
+        {
+          std::this_thread::yield();
+        }
+        size_t done = 0;
+        while(done < stream.size())
+        {
+          auto n = ::write(master, stream.data() + done, stream.size() - done);
+          if(n > 0)
+          {
+            done += static_cast<size_t>(n);
+          }
+          else if(n < 0 && errno != EAGAIN && errno != EINTR)
+          {
+            break;
+          }
+        }
+      }
+    // The stream as 3dscan receives it: through CommandChannel, its reader
+    // thread and input queue, and its line dispatch.
+    auto from_pty(const std::vector<uint8_t>& stream, size_t samples) -> Counts
+      {
+        using clock = std::chrono::steady_clock;
+        int master = -1;
+        int slave  = -1;
+        char path[256];
+        if(openpty(&master, &slave, path, nullptr, nullptr) != 0)
+        {
+          throw std::runtime_error("openpty() failed");
+        }
+        Counts counts;
+        long checksum = 0;
+        {
+          SerialPort port(path);
+          std::atomic<bool> go {false};
+          std::thread scanner([&] { play_scanner(master, stream, go); });
+          CommandChannel channel(port,
+            [&](const ScanFrame& f) { ++counts.frames; checksum += f.range_mm; },
+            [&](std::string_view line) { ++counts.lines; checksum += static_cast<long>(line.size()); }
+          );
+          while(!channel.idle())
+          {
+            channel.poll(std::chrono::milliseconds(100));
+          }
+          counts.lines      = 0;
+          auto allocations  = allocations_.load();
+          auto start        = clock::now();
+          auto heard        = start;
+          go.store(true);
+          while(counts.frames < samples)
+          {
+            auto frames = counts.frames;
+            channel.poll(std::chrono::milliseconds(100));
+            if(counts.frames != frames)
+            {
+              heard = clock::now();
+            }
+            else if(clock::now() - heard > std::chrono::seconds(1))
+            {
+              std::cerr << "timed out after " << counts.frames << " of " << samples << " samples" << std::endl;
+              break;
+            }
+          }
+          std::chrono::duration<double> elapsed = clock::now() - start;
+          counts.seconds      = elapsed.count();
+          counts.allocations  = allocations_.load() - allocations;
+          counts.bad_frames   = channel.decoder().bad_frames();
+          counts.bytes        = stream.size();
+          scanner.join();
+        }
+        close(slave);
+        close(master);
+        return counts;
+      }
+    auto report(const char* label, const Counts& c) -> void
+      {
+        std::cout << label << ": " << c.bytes << " bytes, " << c.frames << " samples, " 
+                  << c.lines << " lines in " << c.seconds << " s\n"
+                  << "  " << c.bytes / c.seconds / 1e6 << " MB/s, "
+                  << c.frames / c.seconds / 1e6 << " M samples/s, "
+                  << c.allocations << " allocations ("
+                  << static_cast<double>(c.allocations) / (c.frames > 0? c.frames : 1) << " per sample)"
+                  << std::endl;
+      }
+  }
+
+auto operator new(size_t size) -> void*
+{
+  ++allocations_;
+  if(auto p = std::malloc(size > 0? size : 1))
+  {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+auto operator delete(void* p) noexcept -> void
+{
+  std::free(p);
+}
+auto operator delete(void* p, size_t) noexcept -> void
+{
+  std::free(p);
+}
+
+int main(int argc, char* argv[])
+{
+  using namespace std;
+  size_t samples  = argc > 1? strtoul(argv[1], nullptr, 10) : 2000000;
+  auto stream     = make_stream(samples);
+  auto memory     = from_memory(stream);
+  auto pty        = from_pty(stream, samples);
+  report("memory", memory);
+  report("pty", pty);
+  auto complete = [&](const Counts& c) { return c.frames == samples && c.bad_frames == 0; };
+  return complete(memory) && complete(pty)? 0 : 1;
+}
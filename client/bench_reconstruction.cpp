@@ -0,0 +1,100 @@
+// Throughput of Reconstruction over a synthetic multi-million-point scan: a
+// cylinder of radius varying with the platform angle, 200 samples per
+// layer.
+//
+//   bench-reconstruction [POINTS]
+//
+// Times collecting the samples with add(), converting them all with one
+// update() as ScanOutput::finish() does, and, for comparison, the plain
+// per-point loop: an array of point structs, with a sine and cosine computed
+// for every sample.
+#include "reconstruction.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace
+  {
+    using clock = std::chrono::steady_clock;
+
+    struct Point
+    {
+      float x, y, z;
+    };
+
+    auto make_scan(size_t points, int platform_steps) -> std::vector<ScanFrame>
+      {
+        std::vector<ScanFrame> frames(points);
+        for(size_t i = 0; i < points; ++i)
+        {
+          auto& f             = frames[i];
+          f.sequence          = static_cast<uint16_t>(i);
+          f.platform_step     = static_cast<int16_t>(i % platform_steps);
+          f.carriage_position = static_cast<int16_t>(i / platform_steps);
+          f.range_mm          = static_cast<uint16_t>(100 + (i * 7) % 23);
+        }
+        return frames;
+      }
+    auto seconds_since(clock::time_point start) -> double
+      {
+        return std::chrono::duration<double>(clock::now() - start).count();
+      }
+    auto report(const char* label, size_t points, double seconds) -> void
+      {
+        std::cout << label << ": " << seconds * 1e3 << " ms, "
+                  << points / seconds / 1e6 << " M points/s" << std::endl;
+      }
+  }
+
+int main(int argc, char* argv[])
+{
+  using namespace std;
+  size_t points = argc > 1? strtoul(argv[1], nullptr, 10) : 4000000;
+  ScanGeometry geometry;
+  auto frames = make_scan(points, geometry.platform_steps);
+  cout << points << " points" << endl;
+
+  Reconstruction reconstruction(geometry);
+  SampleColumns samples;
+  auto start = clock::now();
+  for(const auto& f : frames)
+  {
+    reconstruction.add(samples, f);
+  }
+  report("add", points, seconds_since(start));
+
+  PointCloud cloud;
+  start = clock::now();
+  reconstruction.update(samples, cloud);
+  report("update", points, seconds_since(start));
+
+  vector<Point> reference(points);
+  start = clock::now();
+  for(size_t i = 0; i < points; ++i)
+  {
+    const auto& f = frames[i];
+    auto angle  = 2.0 * M_PI * f.platform_step / geometry.platform_steps;
+    auto radius = geometry.axis_distance_mm - f.range_mm;
+    reference[i] = Point
+      { static_cast<float>(radius * cos(angle))
+      , static_cast<float>(radius * sin(angle))
+      , static_cast<float>(geometry.carriage_mm_per_step * f.carriage_position)
+      };
+  }
+  report("per-point trig", points, seconds_since(start));
+
+  // the two must agree, or the timings mean nothing
+  float worst = 0;
+  for(size_t i = 0; i < points; ++i)
+  {
+    worst = max({ worst
+                , abs(cloud.x[i] - reference[i].x)
+                , abs(cloud.y[i] - reference[i].y)
+                , abs(cloud.z[i] - reference[i].z)
+                });
+  }
+  cout << "largest difference from per-point trig: " << worst << " mm" << endl;
+  return worst < 1e-3f? 0 : 1;
+}
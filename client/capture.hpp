@@ -1,88 +1,277 @@
 #ifndef capture_hpp_20200613_185115_PDT
 #define capture_hpp_20200613_185115_PDT
 
-#include <termios.h>
-#include <fcntl.h>
-#include <unistd.h>
-#include <array>
-#include <fstream>
+#include "command_channel.hpp"
+#include "serial_port.hpp"
+#include "spsc_queue.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <functional>
 #include <iostream>
-#include <sstream>
-#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
 
+// parameters for the firmware's scan.run
+struct ScanOptions
+{
+  int  resolution = 200;    // samples per platform revolution
+  int  layers     = 10;     // carriage layers
+  bool continuous = false;  // range while the platform moves
+  int  adaptive   = 0;      // range jump (mm) that triggers refinement; 0 off
+  int  stride     = 8;      // samples per coarse step when adaptive
+  int  reads      = 1;      // readings filtered into each sample
+  int  filter     = 0;      // 0 median, 1 trimmed mean
+  unsigned baud   = CommandChannel::default_baud_;  // line rate for the scan
+  // resume an interrupted scan after the sample at this carriage position and
+  // platform step, numbering samples from next_sequence; -1 starts afresh
+  int      after_carriage = -1;
+  int      after_step     = 0;
+  uint16_t next_sequence  = 0;
+  // called with the scanner's carriage_max_ and layer spacing before the
+  // scan starts; a non-empty result is why it must not
+  std::function<std::string(int carriage_max, int layer_steps)> check_layout;
+};
+
+// longest the firmware may stay silent mid-scan (layer moves, homing)
+constexpr auto scan_timeout_ = std::chrono::seconds(10);
+
+// Queue the commands for a binary-streamed scan.  scan.run is only sent once
+// every setting has been echoed back and the layout has passed
+// opts.check_layout; otherwise on_end gets a Response whose error says why.
+// on_end runs when scan.run finishes or times out, and the link is back at
+// the default rate.
+inline auto start_scan(CommandChannel& channel, const ScanOptions& opts,
+                       CommandChannel::response_callback_t on_end) -> void
+{
+  using namespace std;
+  using Response = CommandChannel::Response;
+  // firmware built with a larger receive buffer lets more commands be in flight
+  channel.send("system.rx_buffer",
+    [&channel](const Response& r)
+      {
+        auto size = r.lines.size() == 1? strtoul(r.lines[0].c_str(), nullptr, 10) : 0;
+        if(size > CommandChannel::device_rx_window_ + 1)
+        {
+          channel.set_rx_window(size - 1);
+        }
+      }
+  );
+  if(opts.baud != CommandChannel::default_baud_)
+  {
+    channel.change_baud(opts.baud);
+    auto scan_end = std::move(on_end);
+    on_end = [&channel, scan_end](const Response& r)
+      {
+        channel.change_baud(CommandChannel::default_baud_, [scan_end, r](const Response&) { scan_end(r); });
+      };
+  }
+  // leave the scanner talking text to whoever opens the port next
+  {
+    auto scan_end = std::move(on_end);
+    on_end = [&channel, scan_end](const Response& r)
+      {
+        channel.send("stream.binary=0");
+        channel.send("log.binary=0", [scan_end, r](const Response&) { scan_end(r); });
+      };
+  }
+  // responses arrive in order, so the last query sees every setting's
+  struct Setup
+  {
+    string  refused;
+    int     carriage_max = -1;
+  };
+  auto setup = make_shared<Setup>();
+  // the firmware prints a setting's value after setting it, after any error
+  auto set = [&channel, setup](const string& name, long value)
+    {
+      auto echo = to_string(value);
+      channel.send(name + "=" + echo,
+        [setup, echo](const Response& r)
+          {
+            if(setup->refused.empty() && (r.timed_out || r.lines.empty() || r.lines.back() != echo))
+            {
+              setup->refused = "Scanner refused " + r.command
+                             + (r.lines.size() > 1? ": " + r.lines.front() : string());
+            }
+          }
+      );
+    };
+  auto read_int = [](const Response& r)
+    {
+      return r.lines.size() == 1? atoi(r.lines[0].c_str()) : -1;
+    };
+  set("stream.binary", 1);
+  set("log.binary", 1);
+  set("scan.resolution", opts.resolution);
+  set("scan.layers", opts.layers);
+  set("rangefinder.continuous", opts.continuous? 1 : 0);
+  set("rangefinder.reads", opts.reads);
+  set("rangefinder.filter", opts.filter);
+  set("scan.adaptive", opts.adaptive);
+  set("scan.stride", opts.stride);
+  set("scan.after_carriage", opts.after_carriage);
+  if(opts.after_carriage >= 0)
+  {
+    set("scan.after_step", opts.after_step);
+    set("stream.sequence", opts.next_sequence);
+  }
+  channel.send("carriage.max",
+    [setup, read_int](const Response& r)
+      {
+        setup->carriage_max = read_int(r);
+      }
+  );
+  channel.send("scan.layer_steps",
+    [&channel, setup, read_int, check_layout = opts.check_layout, on_end = std::move(on_end)](const Response& r)
+      {
+        auto fail = [&](string why)
+          {
+            Response failed;
+            failed.command  = "scan.run";
+            failed.error    = std::move(why);
+            on_end(failed);
+          };
+        auto layer_steps = read_int(r);
+        if(!setup->refused.empty())
+        {
+          return fail(setup->refused);
+        }
+        if(setup->carriage_max <= 0 || layer_steps <= 0)
+        {
+          return fail("Could not read the scanner's layer layout");
+        }
+        if(check_layout)
+        {
+          auto why = check_layout(setup->carriage_max, layer_steps);
+          if(!why.empty())
+          {
+            return fail(why);
+          }
+        }
+        channel.send("scan.run",
+          [on_end](const Response& r)
+            {
+              auto result = r;
+              if(!r.timed_out && find(r.lines.begin(), r.lines.end(), "#scan.end") == r.lines.end())
+              {
+                result.error = "scan.run did not complete";
+              }
+              on_end(result);
+            },
+          scan_timeout_
+        );
+      }
+  );
+}
+
+// Runs a scan as a pipeline: the channel's reader thread drains the port,
+// the constructing thread decodes and drives the rcode conversation, and a
+// worker thread runs on_frame, fed through a lock-free queue so slow
+// reconstruction or output cannot hold up the serial side.
 class Capture
 {
 public:
-  Capture(const std::string& pp, const std::string& output_file_path)
-      : port_path_(pp)
+  // runs a scan; on_frame is called on the worker thread for every sample
+  Capture(const std::string& pp, const ScanOptions& opts, CommandChannel::frame_callback_t on_frame)
     {
       using namespace std;
-      init_opts(pp);
-      fstream port_file(pp, port_file.in | port_file.out);
-      port_file << "scan" << endl;
-      fstream outfile(output_file_path, outfile.out | outfile.trunc);
-      string line;
-      while(port_file)
+      SpscQueue<ScanFrame, 4096> frames;
+      atomic<bool>       worker_failed {false};
+      exception_ptr      worker_error;
+      thread worker([&]
+        {
+          try
+          {
+            ScanFrame f;
+            while(!frames.drained())
+            {
+              if(frames.pop(f, chrono::milliseconds(100)))
+              {
+                on_frame(f);
+              }
+            }
+          }
+          catch(...)
+          {
+            worker_error = current_exception();
+            worker_failed.store(true);
+          }
+        }
+      );
+      auto stop_worker = [&]
+        {
+          frames.close();
+          worker.join();
+          frame_stats_ = frames.stats();
+        };
+      try
+      {
+        run(pp, opts, [&](const ScanFrame& f) { frames.push(f, &worker_failed); });
+      }
+      catch(...)
+      {
+        stop_worker();
+        throw;
+      }
+      stop_worker();
+      if(worker_error)
       {
-        getline(port_file, line);
-        outfile << line; 
+        rethrow_exception(worker_error);
       }
     }
-  ~Capture()
+  auto print_stats(std::ostream& out) const -> void
     {
-      restore_opts();
+      out << "serial reader -> decoder: " << input_stats_ << '\n'
+          << "decoder -> worker:        " << frame_stats_ << '\n';
     }
-
 private:
-  termios       saved_options_;
-  std::string   port_path_;
-  auto init_opts(const std::string& path) -> void
+  QueueStats  input_stats_;
+  QueueStats  frame_stats_;
+
+  auto run(const std::string& pp, const ScanOptions& opts, CommandChannel::frame_callback_t on_frame) -> void
     {
       using namespace std;
-      auto fd = open(path.c_str(), O_RDWR);
-      if(fd == -1)
-      {
-        string msg = "Could not open port for input: ";
-        msg += path;
-        throw runtime_error(msg);
-      }
-      // set termios to match these settings:
-      // stty -F /dev/ttyUSB0 cs8 115200 ignbrk -brkint -icrnl -imaxbel -opost
-      // -onlcr -isig -icanon -iexten -echo -echoe -echok -echoctl -echoke noflsh
-      // -ixon -crtscts 
-      termios options;
-      if(tcgetattr(fd, &saved_options_) != 0)
+      SerialPort port(pp);
+      auto channel = CommandChannel(port,
+        std::move(on_frame),
+        [&](string_view line)
+          {
+            cerr << line << endl;
+          }
+      );
+      bool    end_of_scan = false;
+      bool    timed_out   = false;
+      string  error;
+      start_scan(channel, opts,
+        [&](const CommandChannel::Response& r)
+          {
+            end_of_scan = true;
+            timed_out   = r.timed_out;
+            error       = r.error;
+          }
+      );
+      while(end_of_scan == false)
       {
-        throw std::runtime_error("Could not save TTY options: tcgetattr() failed");
+        channel.poll(chrono::milliseconds(100));
       }
-      tcgetattr(fd, &options);
-      options.c_cflag &= (~HUPCL);    // prevent arduino reboot on connection
-                                      // serial port
-      const speed_t baud = B115200;
-      if(cfsetspeed(&options, baud) != 0)
+      input_stats_ = channel.input_stats();
+      if(timed_out)
       {
-        throw std::runtime_error("Could not set baud rate");
+        throw runtime_error("Scanner stopped responding during scan.run");
       }
-      if(tcsetattr(fd, TCSANOW, &options) == -1)
+      if(!error.empty())
       {
-        throw std::runtime_error("Could not set port options; tcsetattr failed");
+        throw runtime_error(error);
       }
-      close(fd);
-    }
-  auto restore_opts() -> void
-    { 
-      using namespace std;
-      auto fd = open(port_path_.c_str(), O_RDWR);
-      if(fd != -1)
-      {
-        if(tcsetattr(fd, TCSANOW, &saved_options_) == -1)
-        {
-          cout << "WARNING: Could not restore saved port options; tcsetattr failed" << endl;
-        }
-      } 
-      if(fd != -1)
+      const auto& decoder = channel.decoder();
+      if(decoder.bad_frames() != 0 || decoder.dropped_frames() != 0)
       {
-        close(fd);
+        cerr << "WARNING: " << decoder.bad_frames() << " corrupt and " 
+             << decoder.dropped_frames() << " missing sample frames" << endl;
       }
     }
 };
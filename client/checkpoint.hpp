@@ -0,0 +1,183 @@
+#ifndef checkpoint_hpp_20261017_213402_PDT
+#define checkpoint_hpp_20261017_213402_PDT
+
+#include "capture.hpp"
+#include "point_writer.hpp"
+#include "scan_frame.hpp"
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Journal of a scan in progress, so that one interrupted by a lost link or a
+// board reset can be resumed instead of started over.  The file holds a
+// header line with the options that decide where samples are taken, a line
+// with the scanner's layer layout (see check_layout()), then every sample
+// received, one raw sample line each (see write_raw_sample).  It is flushed
+// whenever the carriage reaches a new layer.
+//
+// Opening an existing journal loads its samples, to be replayed into the
+// output, and sets the resume point in the ScanOptions: the last sample
+// received, and the sequence number to carry on from.  The firmware scans an
+// interrupted adaptive layer again, since its samples are not in platform
+// order, so that layer's samples are dropped here.
+class ScanCheckpoint
+{
+public:
+  ScanCheckpoint(const std::string& path, ScanOptions& opts)
+  : path_(path)
+    {
+      using namespace std;
+      auto header = header_line(opts);
+      ifstream in(path);
+      if(in)
+      {
+        load(in, header, opts);
+        in.close();
+        filesystem::resize_file(path, kept_length_);
+        file_.open(path, ios::app);
+      }
+      else
+      {
+        file_.open(path, ios::trunc);
+        file_ << header << '\n' << flush;
+      }
+      if(!file_)
+      {
+        throw runtime_error("Could not open checkpoint file: " + path);
+      }
+    }
+  ScanCheckpoint(const ScanCheckpoint&) = delete;
+  auto operator=(const ScanCheckpoint&) -> ScanCheckpoint& = delete;
+
+  auto resuming() const -> bool { return last_.has_value(); }
+  // For ScanOptions::check_layout: a resumed scan needs the layers where they
+  // were, so the span and layer spacing must match the journal's.  A new
+  // journal records them.
+  auto check_layout(int carriage_max, int layer_steps) -> std::string
+    {
+      auto layout = layout_line(carriage_max, layer_steps);
+      if(layout_.empty())
+      {
+        layout_ = layout;
+        file_ << layout << '\n' << std::flush;
+        return std::string();
+      }
+      if(layout != layout_)
+      {
+        return "The scanner's layers no longer match checkpoint " + path_ 
+             + " (" + layout_ + ", now " + layout + ")";
+      }
+      return std::string();
+    }
+  // passes the loaded samples to sink, in the order received, and lets them go
+template<typename F>
+  auto replay(F&& sink) -> void
+    {
+      for(const auto& f : loaded_)
+      {
+        sink(f);
+      }
+      loaded_ = std::vector<ScanFrame>();
+    }
+  // called for every sample of the scan
+  auto add(const ScanFrame& f) -> void
+    {
+      if(last_ && last_->carriage_position != f.carriage_position)
+      {
+        file_.flush();
+      }
+      write_raw_sample(file_, f);
+      last_ = f;
+    }
+  // the scan is complete; the journal is no longer needed
+  auto finish() -> void
+    {
+      file_.close();
+      std::filesystem::remove(path_);
+    }
+private:
+  std::string               path_;
+  std::ofstream             file_;
+  std::vector<ScanFrame>    loaded_;
+  std::optional<ScanFrame>  last_;
+  std::string               layout_;
+  std::streamoff            kept_length_  = 0;
+
+  static auto header_line(const ScanOptions& opts) -> std::string
+    {
+      std::ostringstream out;
+      out << "3dscan-checkpoint 1"
+          << " resolution=" << opts.resolution
+          << " layers="     << opts.layers
+          << " adaptive="   << opts.adaptive
+          << " stride="     << opts.stride;
+      return out.str();
+    }
+  static auto layout_line(int carriage_max, int layer_steps) -> std::string
+    {
+      return "layout carriage_max=" + std::to_string(carriage_max)
+           + " layer_steps=" + std::to_string(layer_steps);
+    }
+  // A line cut short by the interruption ends the journal, and is truncated
+  // away with the dropped adaptive layer.
+  auto load(std::ifstream& in, const std::string& header, ScanOptions& opts) -> void
+    {
+      using namespace std;
+      string line;
+      if(!getline(in, line) || line != header)
+      {
+        throw runtime_error("Checkpoint " + path_ + " is for a different scan: " + line);
+      }
+      kept_length_ = in.tellg();
+      // written before the first sample, so a journal without one has none
+      if(!getline(in, line) || in.eof() || line.rfind("layout ", 0) != 0)
+      {
+        return;
+      }
+      layout_       = line;
+      kept_length_  = in.tellg();
+      auto   layer_length = kept_length_;
+      size_t layer_index  = 0;
+      while(getline(in, line) && !in.eof())
+      {
+        istringstream fields(line);
+        long seq, step, carriage, range, status, confidence;
+        if(!(fields >> seq >> step >> carriage >> range >> status >> confidence))
+        {
+          break;
+        }
+        ScanFrame f;
+        f.sequence          = static_cast<uint16_t>(seq);
+        f.platform_step     = static_cast<int16_t>(step);
+        f.carriage_position = static_cast<int16_t>(carriage);
+        f.range_mm          = static_cast<uint16_t>(range);
+        f.status            = static_cast<uint8_t>(status);
+        f.confidence        = static_cast<uint8_t>(confidence);
+        if(last_ && last_->carriage_position != f.carriage_position)
+        {
+          layer_length  = kept_length_;
+          layer_index   = loaded_.size();
+        }
+        loaded_.push_back(f);
+        last_         = f;
+        kept_length_  = in.tellg();
+      }
+      if(last_)
+      {
+        if(opts.adaptive > 0)
+        {
+          loaded_.resize(layer_index);
+          kept_length_ = layer_length;
+        }
+        opts.after_carriage = last_->carriage_position;
+        opts.after_step     = last_->platform_step;
+        opts.next_sequence  = loaded_.empty()? 0 : static_cast<uint16_t>(loaded_.back().sequence + 1);
+      }
+    }
+};
+
+#endif//checkpoint_hpp_20261017_213402_PDT
@@ -0,0 +1,454 @@
+#ifndef command_channel_hpp_20261017_140844_PDT
+#define command_channel_hpp_20261017_140844_PDT
+
+#include "serial_port.hpp"
+#include "spsc_queue.hpp"
+#include "stream_decoder.hpp"
+#include <poll.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Event-driven rcode transport.
+//
+// Commands are queued with send() and written as soon as they fit in the
+// firmware's serial receive buffer, so several can be in flight at once
+// without overrunning the device.  The firmware answers every command line
+// with exactly one "READY" once it has finished with it, which lets responses
+// be matched to commands in FIFO order; any text printed before that READY
+// belongs to the command at the head of the queue.  Sample frames bypass the
+// queue and go straight to the frame callback.
+//
+// Because the port may hold output from before the client connected, the
+// channel first sends "system.sync=<token>" and ignores everything up to the
+// echoed token.  Opening the port resets a Mega, and a line sent while its
+// bootloader runs is lost, so while the scanner stays silent the sync is
+// sent again, with a fresh token, until one is echoed.  If the head command goes quiet for longer than its timeout,
+// everything in flight is failed and the channel resynchronizes.
+//
+// change_baud() moves both ends to another line rate mid-conversation.  It is
+// a barrier: it goes out alone, and the port is switched as soon as the
+// firmware confirms, before its READY arrives at the new rate.
+//
+// By default the port is read on a thread of its own that does nothing but
+// read(2) into the slots of a queue, so however long the owner spends between
+// calls to poll(), the tty is drained promptly.  poll() decodes each slot in
+// place.  Decoding, callbacks and writes to the
+// port all happen on the thread calling poll().
+//
+// With Reading::external there is no reader thread; the owner instead polls
+// the port itself along with others, using events(), handle() and timeout(),
+// and calls service() after each wait.
+class CommandChannel
+{
+public:
+  using clock               = std::chrono::steady_clock;
+  using frame_callback_t    = StreamDecoder::frame_callback_t;
+  using line_callback_t     = StreamDecoder::line_callback_t;
+
+  struct Response
+  {
+    std::string               command;
+    std::vector<std::string>  lines;              // text printed by the command
+    bool                      timed_out = false;
+    std::string               error;              // set by a caller's own checks
+  };
+  using response_callback_t = std::function<void(const Response&)>;
+  enum class Reading { own_thread, external };
+
+  // The Mega's stock HardwareSerial ring buffer holds 64 bytes, one of which
+  // is always kept free; set_rx_window() raises this for firmware built with
+  // a larger one (see system.rx_buffer).
+  static constexpr size_t           device_rx_window_ = 63;
+  static constexpr unsigned         default_baud_     = 115200;
+  static constexpr clock::duration  default_timeout_  = std::chrono::seconds(2);
+  static constexpr clock::duration  sync_timeout_     = std::chrono::seconds(15);
+  static constexpr clock::duration  sync_resend_      = std::chrono::milliseconds(1500);
+  // printed by the firmware every second of a long wait_for_motion()
+  static constexpr std::string_view keep_alive_line_  = "#busy";
+
+  CommandChannel(SerialPort& port, frame_callback_t on_frame, line_callback_t on_line,
+                 Reading reading = Reading::own_thread)
+  : port_(port)
+  , on_line_(std::move(on_line))
+  , decoder_(std::move(on_frame), [this](std::string_view line) { dispatch_line(line); })
+  , sync_token_(static_cast<unsigned>(clock::now().time_since_epoch().count()))
+    {
+      begin_sync();
+      if(reading == Reading::own_thread)
+      {
+        reader_ = std::thread([this] { read_port(); });
+      }
+    }
+  ~CommandChannel()
+    {
+      if(reader_.joinable())
+      {
+        stop_.store(true);
+        reader_.join();
+      }
+    }
+  CommandChannel(const CommandChannel&) = delete;
+  auto operator=(const CommandChannel&) -> CommandChannel& = delete;
+
+  // Queue a command (without its newline).  on_done runs from poll() once the
+  // firmware reports it finished, or once it has been silent for timeout.
+  auto send(std::string command, response_callback_t on_done = {},
+            clock::duration timeout = default_timeout_) -> void
+    {
+      Pending p;
+      p.response.command  = std::move(command);
+      p.on_done           = std::move(on_done);
+      p.timeout           = timeout;
+      queued_.push_back(std::move(p));
+      pump();
+    }
+  // Queue a switch of the link to rate ("system.baud").  If the firmware
+  // refuses, both ends stay where they were.
+  auto change_baud(unsigned rate, response_callback_t on_done = {}) -> void
+    {
+      Pending p;
+      p.response.command  = "system.baud=" + std::to_string(rate);
+      p.on_done           = std::move(on_done);
+      p.timeout           = default_timeout_;
+      p.baud              = rate;
+      queued_.push_back(std::move(p));
+      pump();
+    }
+
+  // bytes the firmware can buffer from us, less one
+  auto set_rx_window(size_t bytes) -> void
+    {
+      rx_window_ = bytes;
+    }
+
+  // Reading::own_thread: one turn of the event loop: wait up to max_wait for input, decode it,
+  // write pending commands and fire completed callbacks.
+  auto poll(clock::duration max_wait) -> void
+    {
+      auto wait = std::min(max_wait, timeout());
+      if(!out_.empty())
+      {
+        // the port was full; retry the write soon
+        wait = std::min<clock::duration>(wait, std::chrono::milliseconds(1));
+      }
+      if(auto block = input_.wait_front(wait))
+      {
+        do
+        {
+          receive(*block);
+          input_.pop_front();
+        } while((block = input_.front()) != nullptr);
+      }
+      else if(input_.drained())
+      {
+        std::rethrow_exception(reader_error_);
+      }
+      service();
+    }
+  // Reading::external: poll() events wanted on port().fd()
+  auto events() const -> short
+    {
+      return POLLIN | (out_.empty()? 0 : POLLOUT);
+    }
+  // Reading::external: act on the events poll() reported
+  auto handle(short revents) -> void
+    {
+      check_revents(revents);
+      if(revents & POLLIN)
+      {
+        size_t n;
+        while((n = port_.read_some(in_.tail(), in_.space())) > 0)
+        {
+          touch();
+          in_.commit(n);
+          decoder_.decode(in_);
+        }
+      }
+      if(revents & POLLOUT)
+      {
+        write_output();
+      }
+    }
+  // Reading::external: longest the owner may wait before calling service()
+  auto timeout() const -> clock::duration
+    {
+      if(!syncing_ && in_flight_.empty())
+      {
+        return clock::duration::max();
+      }
+      auto until = syncing_ && !sync_echoed_? std::min(deadline_, sync_resend_at_) : deadline_;
+      return std::max(clock::duration::zero(), until - clock::now());
+    }
+  auto service() -> void
+    {
+      check_timeout();
+      pump();
+      write_output();
+    }
+
+  // true when nothing is queued, in flight or waiting to be written
+  auto idle() const -> bool
+    {
+      return !syncing_ && queued_.empty() && in_flight_.empty() && out_.empty();
+    }
+  auto decoder() const -> const StreamDecoder& { return decoder_; }
+  auto input_stats() const -> QueueStats      { return input_.stats(); }
+private:
+  struct Pending
+  {
+    Response            response;
+    response_callback_t on_done;
+    clock::duration     timeout;
+    unsigned            baud  = 0;    // a change_baud() barrier
+  };
+
+  SerialPort&         port_;
+  line_callback_t     on_line_;
+  SpscQueue<InputBuffer, 64> input_;     // reader thread -> poll(), read into in place
+  std::thread         reader_;
+  std::atomic<bool>   stop_         {false};
+  std::exception_ptr  reader_error_;      // set before input_ is closed
+  InputBuffer         in_;
+  StreamDecoder       decoder_;
+  std::deque<Pending> queued_;            // waiting for room in the device buffer
+  std::deque<Pending> in_flight_;         // sent, waiting for READY
+  size_t              window_used_  = 0;  // bytes of in_flight_ commands
+  size_t              rx_window_    = device_rx_window_;
+  std::string         out_;               // accepted but not yet written
+  clock::time_point   deadline_;          // head command (or sync) times out
+  clock::time_point   sync_resend_at_;    // silent this long: send the sync again
+  bool                syncing_      = false;
+  bool                sync_echoed_  = false;
+  unsigned            sync_token_   = 0;
+  std::string         sync_echo_;         // expected reply to system.sync
+
+  auto begin_sync() -> void
+    {
+      syncing_      = true;
+      deadline_     = clock::now() + sync_timeout_;
+      send_sync();
+    }
+  // Each attempt has its own token, so the echo of one that was only
+  // delayed, along with its READY, is passed over like any other output.
+  auto send_sync() -> void
+    {
+      sync_echoed_    = false;
+      sync_token_     = (sync_token_ + 1) % 32768;  // firmware int is 16 bits
+      sync_echo_      = "#sync " + std::to_string(sync_token_);
+      out_           += "system.sync=" + std::to_string(sync_token_) + "\n";
+      sync_resend_at_ = clock::now() + sync_resend_;
+    }
+  // move queued commands into flight while they fit in the device buffer
+  auto pump() -> void
+    {
+      while(!syncing_ && !queued_.empty())
+      {
+        auto size = queued_.front().response.command.size() + 1;
+        if(!in_flight_.empty() && window_used_ + size > rx_window_)
+        {
+          break;
+        }
+        // a rate change travels alone
+        if(!in_flight_.empty() && (queued_.front().baud != 0 || in_flight_.back().baud != 0))
+        {
+          break;
+        }
+        if(in_flight_.empty())
+        {
+          deadline_ = clock::now() + queued_.front().timeout;
+        }
+        out_          += queued_.front().response.command;
+        out_          += '\n';
+        window_used_  += size;
+        in_flight_.push_back(std::move(queued_.front()));
+        queued_.pop_front();
+      }
+    }
+  // reader thread
+  auto read_port() -> void
+    {
+      try
+      {
+        while(!stop_.load())
+        {
+          pollfd p = { port_.fd(), POLLIN, 0 };
+          if(::poll(&p, 1, 50) < 0 && errno != EINTR)
+          {
+            throw std::runtime_error("poll() failed on serial port");
+          }
+          check_revents(p.revents);
+          if(p.revents & POLLIN)
+          {
+            auto block = input_.wait_back(&stop_);
+            if(block == nullptr)
+            {
+              continue;
+            }
+            block->clear();
+            if(auto n = port_.read_some(block->tail(), block->space()))
+            {
+              block->commit(n);
+              input_.push_back();
+            }
+          }
+        }
+        throw std::runtime_error("Serial port reader stopped");
+      }
+      catch(...)
+      {
+        reader_error_ = std::current_exception();
+        input_.close();
+      }
+    }
+  static auto check_revents(short revents) -> void
+    {
+      if(revents & (POLLERR | POLLNVAL))
+      {
+        throw std::runtime_error("Serial port error");
+      }
+      if((revents & (POLLIN | POLLHUP)) == POLLHUP)
+      {
+        throw std::runtime_error("Serial port closed");
+      }
+    }
+  // input arrived: restart the head command's inactivity timeout; while
+  // syncing, a talking scanner has likely queued the sync behind its output
+  auto touch() -> void
+    {
+      if(!in_flight_.empty())
+      {
+        deadline_ = clock::now() + in_flight_.front().timeout;
+      }
+      if(syncing_)
+      {
+        sync_resend_at_ = clock::now() + sync_resend_;
+      }
+    }
+  // Decodes a block from the reader thread where it lies.  Only what is left
+  // over at its end, normally part of a frame or line, is copied out, to go
+  // in front of the next block.
+  auto receive(InputBuffer& block) -> void
+    {
+      touch();
+      if(!in_.empty() && block.prepend(in_.data(), in_.size()))
+      {
+        in_.clear();
+      }
+      if(in_.empty())
+      {
+        decoder_.decode(block);
+        std::copy_n(block.data(), block.size(), in_.tail());
+        in_.commit(block.size());
+        return;
+      }
+      // a partial line too long for the headroom: append the block instead
+      size_t done = 0;
+      while(done < block.size())
+      {
+        auto n = std::min(block.size() - done, in_.space());
+        std::copy_n(block.data() + done, n, in_.tail());
+        in_.commit(n);
+        decoder_.decode(in_);
+        done += n;
+      }
+    }
+  auto write_output() -> void
+    {
+      auto n = port_.write_some(out_.data(), out_.size());
+      out_.erase(0, n);
+    }
+  auto dispatch_line(std::string_view line) -> void
+    {
+      if(line == keep_alive_line_)
+      {
+        // the firmware is busy with a long move; receive() restarted the timeout
+        return;
+      }
+      if(syncing_)
+      {
+        if(line == sync_echo_)
+        {
+          sync_echoed_ = true;
+        }
+        else if(sync_echoed_ && line == "READY")
+        {
+          syncing_ = false;
+        }
+        else if(line != "READY")
+        {
+          on_line_(line);
+        }
+        return;
+      }
+      if(line == "READY")
+      {
+        // a READY with nothing in flight is the firmware's idle prompt
+        if(!in_flight_.empty())
+        {
+          complete_head(false);
+        }
+        return;
+      }
+      if(!in_flight_.empty())
+      {
+        auto& head = in_flight_.front();
+        if(head.baud != 0 && line == "#baud " + std::to_string(head.baud))
+        {
+          port_.set_baud(head.baud);
+        }
+        head.response.lines.emplace_back(line);
+      }
+      on_line_(line);
+    }
+  auto complete_head(bool timed_out) -> void
+    {
+      auto p = std::move(in_flight_.front());
+      in_flight_.pop_front();
+      window_used_ -= p.response.command.size() + 1;
+      if(!in_flight_.empty())
+      {
+        deadline_ = clock::now() + in_flight_.front().timeout;
+      }
+      p.response.timed_out = timed_out;
+      if(p.on_done)
+      {
+        p.on_done(p.response);
+      }
+    }
+  auto check_timeout() -> void
+    {
+      auto now = clock::now();
+      if(syncing_ && !sync_echoed_ && now >= sync_resend_at_ && now < deadline_)
+      {
+        send_sync();
+        return;
+      }
+      if((!syncing_ && in_flight_.empty()) || now < deadline_)
+      {
+        return;
+      }
+      if(syncing_)
+      {
+        throw std::runtime_error("Scanner not responding on " + port_.path());
+      }
+      // The firmware's position in the queue is unknown now; fail everything
+      // already sent and start over from a known point.
+      while(!in_flight_.empty())
+      {
+        complete_head(true);
+      }
+      begin_sync();
+    }
+};
+
+#endif//command_channel_hpp_20261017_140844_PDT
@@ -0,0 +1,302 @@
+#ifndef farm_hpp_20261017_194420_PDT
+#define farm_hpp_20261017_194420_PDT
+
+#include "capture.hpp"
+#include "command_channel.hpp"
+#include "serial_port.hpp"
+#include "spsc_queue.hpp"
+#include <poll.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Scans on several scanners at once from a single event loop.
+//
+// Every port is read, decoded and driven by the constructing thread through
+// one poll() over all of them (CommandChannel's Reading::external mode), so
+// an idle rack costs one sleeping thread rather than a process per scanner.
+// Sample frames go through a per-scanner lock-free queue to a shared pool of
+// workers that run each scanner's sink; an idle worker sleeps on a signal
+// that all of its scanners' queues ring.  A scanner is always served by the
+// same worker, so its sink sees frames in order and needs no locking, and
+// the same worker finishes the sink (reconstruction, writing the output)
+// as soon as that scanner is done, while the others carry on.
+//
+// A scanner that fails (port error, timeout, exception from its sink) is
+// reported and dropped without disturbing the others.  Its sink is only
+// made once its port is open, and is discarded rather than finished.
+class Farm
+{
+public:
+  // what is done with one scanner's samples
+  struct Sink
+  {
+    CommandChannel::frame_callback_t  add;
+    std::function<void()>             finish;   // the scan completed
+    std::function<void()>             discard;  // it failed
+  };
+  using sink_factory_t = std::function<Sink(size_t port_index)>;
+
+  Farm(const std::vector<std::string>&  ports,
+       const ScanOptions&               opts,
+       const sink_factory_t&            make_sink,
+       size_t                           workers)
+    {
+      for(size_t i = 0; i < ports.size(); ++i)
+      {
+        devices_.push_back(std::make_unique<Device>(ports[i]));
+      }
+      workers = std::max<size_t>(1, std::min(workers, devices_.size()));
+      wake_ = std::make_unique<WakeSignal[]>(workers);
+      for(size_t i = 0; i < devices_.size(); ++i)
+      {
+        devices_[i]->frames.set_consumer_signal(wake_[i % workers]);
+        start(*devices_[i], opts, make_sink, i);
+      }
+      std::vector<std::thread> pool;
+      for(size_t w = 0; w < workers; ++w)
+      {
+        pool.emplace_back([this, w, workers] { work(w, workers); });
+      }
+      run();
+      for(auto& d : devices_)
+      {
+        d->channel.reset();
+        d->frames.close();
+      }
+      for(auto& t : pool)
+      {
+        t.join();
+      }
+      for(auto& d : devices_)
+      {
+        if(d->sink_error && d->error.empty())
+        {
+          try
+          {
+            std::rethrow_exception(d->sink_error);
+          }
+          catch(const std::exception& e)
+          {
+            fail(*d, e.what());
+          }
+        }
+        if(!d->error.empty() && d->sink.discard)
+        {
+          d->sink.discard();
+        }
+      }
+    }
+
+  // ports whose scan did not complete
+  auto failures() const -> size_t
+    {
+      return std::count_if(devices_.begin(), devices_.end(),
+        [](const std::unique_ptr<Device>& d) { return !d->error.empty(); }
+      );
+    }
+  auto print_stats(std::ostream& out) const -> void
+    {
+      for(auto& d : devices_)
+      {
+        out << d->path << " decoder -> worker: " << d->frames.stats() << '\n';
+      }
+    }
+private:
+  struct Device
+  {
+    explicit Device(const std::string& p)
+    : path(p)
+      {
+      }
+    std::string                       path;
+    Sink                              sink;
+    bool                              finished = false;   // worker only
+    std::unique_ptr<SerialPort>       port;
+    std::unique_ptr<CommandChannel>   channel;
+    SpscQueue<ScanFrame, 4096>        frames;       // event loop -> worker
+    bool                              running = false;
+    std::string                       error;
+    std::exception_ptr                sink_error;   // set by the worker
+  };
+
+  std::vector<std::unique_ptr<Device>> devices_;
+  std::unique_ptr<WakeSignal[]>         wake_;    // one per worker, rung by its scanners' queues
+
+  auto start(Device& d, const ScanOptions& opts, const sink_factory_t& make_sink, size_t index) -> void
+    {
+      try
+      {
+        d.port    = std::make_unique<SerialPort>(d.path);
+        d.sink    = make_sink(index);
+        d.channel = std::make_unique<CommandChannel>(*d.port,
+          [&d](const ScanFrame& f)
+            {
+              d.frames.push(f);
+            },
+          [&d](std::string_view line)
+            {
+              std::cerr << '[' << d.path << "] " << line << std::endl;
+            },
+          CommandChannel::Reading::external
+        );
+        d.running = true;
+        start_scan(*d.channel, opts,
+          [this, &d](const CommandChannel::Response& r)
+            {
+              if(r.timed_out)
+              {
+                fail(d, "Scanner stopped responding during scan.run");
+              }
+              else if(!r.error.empty())
+              {
+                fail(d, r.error);
+              }
+              stop(d);
+            }
+        );
+      }
+      catch(const std::exception& e)
+      {
+        fail(d, e.what());
+      }
+    }
+  auto fail(Device& d, const std::string& why) -> void
+    {
+      std::cerr << '[' << d.path << "] ERROR: " << why << std::endl;
+      d.error   = why;
+      stop(d);
+    }
+  // no more frames; error, if any, is set first so the worker sees it
+  auto stop(Device& d) -> void
+    {
+      d.running = false;
+      d.frames.close();
+    }
+  // the event loop: one poll() across every scanner still scanning
+  auto run() -> void
+    {
+      using namespace std::chrono;
+      std::vector<pollfd>   fds;
+      std::vector<Device*>  polled;
+      while(true)
+      {
+        fds.clear();
+        polled.clear();
+        auto wait = CommandChannel::clock::duration(milliseconds(100));
+        for(auto& d : devices_)
+        {
+          if(d->running)
+          {
+            fds.push_back(pollfd { d->port->fd(), d->channel->events(), 0 });
+            polled.push_back(d.get());
+            wait = std::min(wait, d->channel->timeout());
+          }
+        }
+        if(polled.empty())
+        {
+          return;
+        }
+        auto ms = duration_cast<milliseconds>(wait + milliseconds(1) - nanoseconds(1)).count();
+        if(::poll(fds.data(), fds.size(), static_cast<int>(ms)) < 0 && errno != EINTR)
+        {
+          throw std::runtime_error("poll() failed on serial ports");
+        }
+        for(size_t i = 0; i < polled.size(); ++i)
+        {
+          auto& d = *polled[i];
+          try
+          {
+            d.channel->handle(fds[i].revents);
+            d.channel->service();
+          }
+          catch(const std::exception& e)
+          {
+            fail(d, e.what());
+          }
+        }
+      }
+    }
+  // worker w of n: a frame waits, or a scanner is ready to be finished
+  auto has_work(size_t w, size_t n) -> bool
+    {
+      for(size_t i = w; i < devices_.size(); i += n)
+      {
+        auto& d = *devices_[i];
+        if(d.frames.front() != nullptr || (d.frames.drained() && !d.finished))
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+  // worker w of n serves every nth scanner
+  auto work(size_t w, size_t n) -> void
+    {
+      for(int idle = 0; ; )
+      {
+        bool any      = false;
+        bool drained  = true;
+        for(size_t i = w; i < devices_.size(); i += n)
+        {
+          auto&     d = *devices_[i];
+          ScanFrame f;
+          while(d.frames.try_pop(f))
+          {
+            any = true;
+            if(d.sink_error)
+            {
+              continue;   // keep draining so the event loop never blocks
+            }
+            try
+            {
+              d.sink.add(f);
+            }
+            catch(...)
+            {
+              d.sink_error = std::current_exception();
+            }
+          }
+          if(d.frames.drained() && !d.finished)
+          {
+            d.finished = true;
+            any        = true;
+            if(d.error.empty() && !d.sink_error && d.sink.finish)
+            {
+              try
+              {
+                d.sink.finish();
+              }
+              catch(...)
+              {
+                d.sink_error = std::current_exception();
+              }
+            }
+          }
+          drained = drained && d.frames.drained();
+        }
+        if(drained)
+        {
+          return;
+        }
+        idle = any? 0 : idle + 1;
+        if(idle > 64)
+        {
+          wake_[w].wait([&] { return has_work(w, n); }, std::chrono::milliseconds(100));
+        }
+        else if(idle > 0)
+        {
+          std::this_thread::yield();
+        }
+      }
+    }
+};
+
+#endif//farm_hpp_20261017_194420_PDT
@@ -0,0 +1,67 @@
+#ifndef input_buffer_hpp_20261017_152210_PDT
+#define input_buffer_hpp_20261017_152210_PDT
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+// Fixed-size receive buffer filled straight from read(2).  Unread bytes are
+// always contiguous, so the decoder can hand out views into them instead of
+// copying; consumed space is reclaimed by sliding the unread tail (normally a
+// partial line or frame, a few bytes) back to the front before each read.
+//
+// The front keeps headroom_ bytes free, so that when buffers are filled one
+// after another (CommandChannel's reader thread), the unread tail of one can
+// be prepend()ed to the next instead of the next being copied after it.
+class InputBuffer
+{
+public:
+  static constexpr size_t capacity_ = 4096;
+  static constexpr size_t headroom_ = 256;
+
+  auto data() const  -> const uint8_t* { return buffer_.data() + begin_; }
+  auto size() const  -> size_t         { return end_ - begin_; }
+  auto empty() const -> bool           { return begin_ == end_; }
+  auto full() const  -> bool           { return size() >= capacity_; }
+
+  // free space for the next read; commit() the number of bytes stored there
+  auto tail() -> uint8_t*
+    {
+      if(begin_ != headroom_)
+      {
+        std::memmove(buffer_.data() + headroom_, data(), size());
+        end_   -= begin_ - headroom_;
+        begin_  = headroom_;
+      }
+      return buffer_.data() + end_;
+    }
+  auto space() const -> size_t         { return capacity_ > size()? capacity_ - size() : 0; }
+  auto commit(size_t n) -> void        { end_ += n; }
+  auto consume(size_t n) -> void
+    {
+      begin_ += n;
+      if(begin_ == end_)
+      {
+        clear();
+      }
+    }
+  auto clear() -> void                 { begin_ = end_ = headroom_; }
+  // put n bytes in front of the unread ones; false, changing nothing, if
+  // there is no room for them there
+  auto prepend(const uint8_t* p, size_t n) -> bool
+    {
+      if(n > begin_)
+      {
+        return false;
+      }
+      begin_ -= n;
+      std::memcpy(buffer_.data() + begin_, p, n);
+      return true;
+    }
+private:
+  std::array<uint8_t, headroom_ + capacity_>  buffer_;
+  size_t                                      begin_  = headroom_;
+  size_t                                      end_    = headroom_;
+};
+
+#endif//input_buffer_hpp_20261017_152210_PDT
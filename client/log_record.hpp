@@ -0,0 +1 @@
+../3d-scanner-arduino-mega2560/log_record.hpp
\ No newline at end of file
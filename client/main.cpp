@@ -1,6 +1,13 @@
 #include "capture.hpp"
+#include "checkpoint.hpp"
+#include "farm.hpp"
+#include "scan_output.hpp"
+#include <filesystem>
+#include <memory>
 #include <string>
 #include <iostream>
+#include <thread>
+#include <vector>
 #include <boost/program_options.hpp>
 
 int main(int argc, char* argv[])
@@ -11,8 +18,21 @@ int main(int argc, char* argv[])
   po::options_description desc("Allowed options");
   desc.add_options()
       ("help", "produce help message")
-      ("port,p", po::value<string>(), "serial port path")
-      ("output,o", po::value<string>(), "output file")
+      ("port,p", po::value<vector<string>>(), "serial port path; repeat to scan on several scanners at once")
+      ("output,o", po::value<string>(), "output file; with several ports, NAME.EXT becomes NAME-0.EXT, NAME-1.EXT, ...")
+      ("resolution,r", po::value<int>()->default_value(200), "samples per platform revolution")
+      ("layers,l", po::value<int>()->default_value(10), "number of carriage layers")
+      ("continuous", "range continuously while the platform moves")
+      ("reads", po::value<int>()->default_value(1), "range readings the scanner filters into each sample (1-15)")
+      ("filter", po::value<string>()->default_value("median"), "on-scanner filter for --reads: median or trimmed-mean")
+      ("adaptive", po::value<int>()->default_value(0), "sample coarsely, refining where the range jumps by more than this many mm (0: off)")
+      ("stride", po::value<int>()->default_value(8), "samples per coarse step with --adaptive")
+      ("format,f", po::value<string>()->default_value("raw"), "output format: raw (samples), xyz, ply or columns (points), obj (mesh)")
+      ("baud", po::value<unsigned>()->default_value(115200), "line rate to switch to for the scan, e.g. 500000 or 1000000")
+      ("checkpoint", po::value<string>(), "journal the scan to this file, and resume the interrupted scan it holds if it exists")
+      ("stats", "print pipeline queue statistics after the scan")
+      ("workers", po::value<unsigned>()->default_value(thread::hardware_concurrency()), "worker threads shared by several scanners")
+      ("axis-distance", po::value<double>()->default_value(150.0), "rangefinder to platform axis distance in mm")
   ;
 
   po::variables_map vm;
@@ -31,7 +51,7 @@ int main(int argc, char* argv[])
     return 1;
   }
   bool using_standard_output = false;
-  string port;
+  vector<string> ports;
   string output;
   try
   {
@@ -42,7 +62,7 @@ int main(int argc, char* argv[])
     }
     else
     {
-      port = vm["port"].as<string>();
+      ports = vm["port"].as<vector<string>>();
     }
     // output file
     if(vm.count("output") == 0)
@@ -53,14 +73,113 @@ int main(int argc, char* argv[])
     {
       output = vm["output"].as<string>();
     }
-    auto capture = Capture(port, output); 
+    ScanOptions scan_options;
+    scan_options.resolution = vm["resolution"].as<int>();
+    scan_options.layers     = vm["layers"].as<int>();
+    scan_options.continuous = vm.count("continuous") != 0;
+    scan_options.reads      = vm["reads"].as<int>();
+    auto filter = vm["filter"].as<string>();
+    if(filter != "median" && filter != "trimmed-mean")
+    {
+      throw runtime_error("Unknown filter: " + filter);
+    }
+    scan_options.filter     = filter == "median"? 0 : 1;
+    scan_options.adaptive   = vm["adaptive"].as<int>();
+    scan_options.stride     = vm["stride"].as<int>();
+    scan_options.baud       = vm["baud"].as<unsigned>();
+    SerialPort::speed_of(scan_options.baud);   // reject what this host can't do up front
+    auto format = parse_output_format(vm["format"].as<string>());
+    ScanGeometry geometry;
+    geometry.axis_distance_mm = vm["axis-distance"].as<double>();
+
+    if(ports.size() == 1)
+    {
+      // before the output is opened, which truncates it
+      unique_ptr<ScanCheckpoint> checkpoint;
+      if(vm.count("checkpoint"))
+      {
+        checkpoint = make_unique<ScanCheckpoint>(vm["checkpoint"].as<string>(), scan_options);
+        scan_options.check_layout = [&](int carriage_max, int layer_steps)
+          {
+            return checkpoint->check_layout(carriage_max, layer_steps);
+          };
+      }
+      ScanOutput scan_output(format, output, geometry);
+      if(checkpoint)
+      {
+        if(checkpoint->resuming())
+        {
+          cerr << "Resuming after carriage position " << scan_options.after_carriage
+               << ", platform step " << scan_options.after_step << endl;
+        }
+        checkpoint->replay([&](const ScanFrame& f) { scan_output.add(f); });
+      }
+      auto capture = Capture(ports[0], scan_options, 
+        [&](const ScanFrame& f)
+          {
+            if(checkpoint)
+            {
+              checkpoint->add(f);
+            }
+            scan_output.add(f);
+          }
+      );
+      scan_output.finish();
+      if(checkpoint)
+      {
+        checkpoint->finish();
+      }
+      if(vm.count("stats"))
+      {
+        capture.print_stats(cerr);
+        cerr << "worker -> writer:         " << scan_output.writer_stats() << endl;
+      }
+      return 0;
+    }
+    // farm mode: one output per port
+    if(vm.count("checkpoint"))
+    {
+      throw runtime_error("--checkpoint takes a single port");
+    }
+    if(using_standard_output)
+    {
+      throw runtime_error("Scanning on several ports needs an output file");
+    }
+    // outputs are made as each scanner connects, and finished on the farm's
+    // workers
+    vector<unique_ptr<ScanOutput>> outputs(ports.size());
+    auto make_sink = [&](size_t i)
+      {
+        auto dot  = output.find_last_of('.');
+        auto path = dot == string::npos || output.find('/', dot) != string::npos
+          ? output + "-" + to_string(i)
+          : output.substr(0, dot) + "-" + to_string(i) + output.substr(dot);
+        outputs[i] = make_unique<ScanOutput>(format, path, geometry);
+        auto o = outputs[i].get();
+        return Farm::Sink
+          { [o](const ScanFrame& f) { o->add(f); }
+          , [o] { o->finish(); }
+          , [&outputs, i, path]
+              {
+                outputs[i].reset();
+                filesystem::remove(path);
+              }
+          };
+      };
+    auto farm = Farm(ports, scan_options, make_sink, vm["workers"].as<unsigned>());
+    if(vm.count("stats"))
+    {
+      farm.print_stats(cerr);
+    }
+    return farm.failures() == 0? 0 : 1;
   }
   catch(const std::exception& e)
   {
     using namespace std;
-    cout << e.what() << "\n"
+    cerr << e.what() << "\n"
          << "\n"
          << "Use \"--help\" to display program options.\n"
          << endl;
+    return 1;
   }
 }
@@ -0,0 +1,157 @@
+#ifndef point_writer_hpp_20261017_161742_PDT
+#define point_writer_hpp_20261017_161742_PDT
+
+#include "reconstruction.hpp"
+#include "scan_frame.hpp"
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+  "binary point formats are written in host byte order");
+
+// one "seq platform_step carriage_position range_mm status confidence" line
+// per sample
+inline auto write_raw_sample(std::ostream& out, const ScanFrame& f) -> void
+{
+  out << f.sequence           << ' '
+      << f.platform_step      << ' '
+      << f.carriage_position  << ' '
+      << f.range_mm           << ' '
+      << static_cast<int>(f.status) << ' '
+      << static_cast<int>(f.confidence) << '\n';
+}
+
+// one "x y z" line per valid point (status 0), in millimetres
+inline auto write_xyz(std::ostream& out, const PointCloud& cloud) -> void
+{
+  for(size_t i = 0; i < cloud.size(); ++i)
+  {
+    if(cloud.status[i] == 0)
+    {
+      out << cloud.x[i] << ' ' << cloud.y[i] << ' ' << cloud.z[i] << '\n';
+    }
+  }
+}
+
+// Binary little-endian PLY with one vertex per valid point:
+// float x, y, z; ushort range; uchar status, confidence.  Records are packed into a
+// buffer and written in large blocks.
+inline auto write_ply(std::ostream& out, const PointCloud& cloud) -> void
+{
+  size_t count = 0;
+  for(auto s : cloud.status)
+  {
+    count += s == 0;
+  }
+  out << "ply\n"
+      << "format binary_little_endian 1.0\n"
+      << "comment 3dscan point cloud, millimetres\n"
+      << "element vertex " << count << '\n'
+      << "property float x\n"
+      << "property float y\n"
+      << "property float z\n"
+      << "property ushort range\n"
+      << "property uchar status\n"
+      << "property uchar confidence\n"
+      << "end_header\n";
+  constexpr size_t record_size  = 3 * sizeof(float) + sizeof(uint16_t) + 2 * sizeof(uint8_t);
+  constexpr size_t block_size   = 4096 * record_size;
+  std::vector<char> block(block_size);
+  size_t fill = 0;
+  for(size_t i = 0; i < cloud.size(); ++i)
+  {
+    if(cloud.status[i] != 0)
+    {
+      continue;
+    }
+    auto p = block.data() + fill;
+    std::memcpy(p,      &cloud.x[i],        sizeof(float));
+    std::memcpy(p + 4,  &cloud.y[i],        sizeof(float));
+    std::memcpy(p + 8,  &cloud.z[i],        sizeof(float));
+    std::memcpy(p + 12, &cloud.range_mm[i], sizeof(uint16_t));
+    std::memcpy(p + 14, &cloud.status[i],   sizeof(uint8_t));
+    std::memcpy(p + 15, &cloud.confidence[i], sizeof(uint8_t));
+    fill += record_size;
+    if(fill == block_size)
+    {
+      out.write(block.data(), fill);
+      fill = 0;
+    }
+  }
+  out.write(block.data(), fill);
+}
+
+// Columnar point file meant to be mmap'd by readers:
+//
+//   offset 0   char[8]   "3DSCOLS2"
+//          8   uint64    point count N
+//         16   uint64    offset of float32 x[N]
+//         24   uint64    offset of float32 y[N]
+//         32   uint64    offset of float32 z[N]
+//         40   uint64    offset of uint16 range_mm[N]
+//         48   uint64    offset of uint8 status[N]
+//         56   uint64    offset of uint8 confidence[N]
+//
+// Every point is stored, including failed measurements (status != 0); each
+// column starts on a 64 byte boundary.  Little-endian throughout.
+struct ColumnFileHeader
+{
+  char      magic[8] = { '3', 'D', 'S', 'C', 'O', 'L', 'S', '2' };
+  uint64_t  count    = 0;
+  uint64_t  x        = 0;
+  uint64_t  y        = 0;
+  uint64_t  z        = 0;
+  uint64_t  range_mm = 0;
+  uint64_t  status   = 0;
+  uint64_t  confidence = 0;
+};
+
+inline auto write_columns(const std::string& path, const PointCloud& cloud) -> void
+{
+  constexpr uint64_t alignment = 64;
+  auto aligned = [&](uint64_t n) { return (n + alignment - 1) / alignment * alignment; };
+  ColumnFileHeader header;
+  const uint64_t n  = cloud.size();
+  header.count      = n;
+  header.x          = aligned(sizeof(header));
+  header.y          = aligned(header.x + n * sizeof(float));
+  header.z          = aligned(header.y + n * sizeof(float));
+  header.range_mm   = aligned(header.z + n * sizeof(float));
+  header.status     = aligned(header.range_mm + n * sizeof(uint16_t));
+  header.confidence = aligned(header.status + n * sizeof(uint8_t));
+  const auto size   = header.confidence + n * sizeof(uint8_t);
+
+  auto fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if(fd == -1)
+  {
+    throw std::runtime_error("Could not open output file: " + path);
+  }
+  if(ftruncate(fd, static_cast<off_t>(size)) != 0)
+  {
+    close(fd);
+    throw std::runtime_error("Could not size output file: " + path);
+  }
+  auto map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED)
+  {
+    throw std::runtime_error("Could not map output file: " + path);
+  }
+  auto base = static_cast<char*>(map);
+  std::memcpy(base, &header, sizeof(header));
+  std::memcpy(base + header.x,        cloud.x.data(),        n * sizeof(float));
+  std::memcpy(base + header.y,        cloud.y.data(),        n * sizeof(float));
+  std::memcpy(base + header.z,        cloud.z.data(),        n * sizeof(float));
+  std::memcpy(base + header.range_mm, cloud.range_mm.data(), n * sizeof(uint16_t));
+  std::memcpy(base + header.status,   cloud.status.data(),   n * sizeof(uint8_t));
+  std::memcpy(base + header.confidence, cloud.confidence.data(), n * sizeof(uint8_t));
+  munmap(map, size);
+}
+
+#endif//point_writer_hpp_20261017_161742_PDT
@@ -0,0 +1,147 @@
+#ifndef reconstruction_hpp_20261017_160405_PDT
+#define reconstruction_hpp_20261017_160405_PDT
+
+#include "scan_frame.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Mechanical constants needed to turn (platform step, carriage step, range)
+// samples into positions.  Defaults follow control.cpp: a 200 step platform
+// and a 200 step carriage motor driving a 2 mm pitch, 4 start lead screw.
+struct ScanGeometry
+{
+  int     platform_steps          = 200;          // per platform revolution
+  double  carriage_mm_per_step    = 2.0 * 4 / 200;
+  double  axis_distance_mm        = 150.0;        // sensor to platform axis
+};
+
+// Raw samples, one column per field.
+struct SampleColumns
+{
+  std::vector<uint16_t> platform_step;
+  std::vector<int16_t>  carriage_position;
+  std::vector<uint16_t> range_mm;
+  std::vector<uint8_t>  status;
+  std::vector<uint8_t>  confidence;
+
+  auto size() const -> size_t { return range_mm.size(); }
+  auto clear() -> void
+    {
+      platform_step.clear();
+      carriage_position.clear();
+      range_mm.clear();
+      status.clear();
+      confidence.clear();
+    }
+};
+
+// Reconstructed points, one column per coordinate.  range_mm, status and
+// confidence are carried over from the samples so writers can drop failed
+// measurements.
+struct PointCloud
+{
+  std::vector<float>    x;
+  std::vector<float>    y;
+  std::vector<float>    z;
+  std::vector<uint16_t> range_mm;
+  std::vector<uint8_t>  status;
+  std::vector<uint8_t>  confidence;
+
+  auto size() const -> size_t { return x.size(); }
+  auto clear() -> void
+    {
+      x.clear();
+      y.clear();
+      z.clear();
+      range_mm.clear();
+      status.clear();
+      confidence.clear();
+    }
+};
+
+// Converts scan samples to Cartesian points with the platform axis as z.
+//
+// Samples are collected column-wise and converted in batches by a kernel with
+// no branches or calls in its loop: the per-step sines and cosines come from a
+// table built once, so the loop is a gather plus a few multiplies that the
+// compiler can vectorize.
+class Reconstruction
+{
+public:
+  explicit Reconstruction(const ScanGeometry& g)
+  : geometry_(g)
+  , cos_(g.platform_steps)
+  , sin_(g.platform_steps)
+    {
+      for(int i = 0; i < g.platform_steps; ++i)
+      {
+        auto angle = 2.0 * M_PI * i / g.platform_steps;
+        cos_[i] = static_cast<float>(std::cos(angle));
+        sin_[i] = static_cast<float>(std::sin(angle));
+      }
+    }
+
+  // append a sample, folding its platform step into one revolution
+  auto add(SampleColumns& samples, const ScanFrame& f) const -> void
+    {
+      // % keeps the sign of a negative step from an unexpected frame
+      auto step = f.platform_step % geometry_.platform_steps;
+      samples.platform_step.push_back(step < 0? step + geometry_.platform_steps : step);
+      samples.carriage_position.push_back(f.carriage_position);
+      samples.range_mm.push_back(f.range_mm);
+      samples.status.push_back(f.status);
+      samples.confidence.push_back(f.confidence);
+    }
+  // convert the samples that points does not cover yet and append them
+  auto update(const SampleColumns& samples, PointCloud& points) const -> void
+    {
+      auto first  = points.size();
+      auto n      = samples.size() - first;
+      points.x.resize(first + n);
+      points.y.resize(first + n);
+      points.z.resize(first + n);
+      points.range_mm.insert(points.range_mm.end(), samples.range_mm.begin() + first, samples.range_mm.end());
+      points.status.insert(points.status.end(), samples.status.begin() + first, samples.status.end());
+      points.confidence.insert(points.confidence.end(), samples.confidence.begin() + first, samples.confidence.end());
+      to_cartesian(
+        n,
+        samples.platform_step.data() + first,
+        samples.carriage_position.data() + first,
+        samples.range_mm.data() + first,
+        points.x.data() + first,
+        points.y.data() + first,
+        points.z.data() + first
+      );
+    }
+  auto geometry() const -> const ScanGeometry& { return geometry_; }
+private:
+  ScanGeometry        geometry_;
+  std::vector<float>  cos_;
+  std::vector<float>  sin_;
+
+  auto to_cartesian(
+      size_t                      n,
+      const uint16_t* __restrict  step,
+      const int16_t*  __restrict  carriage,
+      const uint16_t* __restrict  range,
+      float*          __restrict  x,
+      float*          __restrict  y,
+      float*          __restrict  z) const -> void
+    {
+      const auto  axis    = static_cast<float>(geometry_.axis_distance_mm);
+      const auto  z_scale = static_cast<float>(geometry_.carriage_mm_per_step);
+      const auto* c       = cos_.data();
+      const auto* s       = sin_.data();
+      for(size_t i = 0; i < n; ++i)
+      {
+        auto radius = axis - static_cast<float>(range[i]);
+        x[i] = radius * c[step[i]];
+        y[i] = radius * s[step[i]];
+        z[i] = z_scale * static_cast<float>(carriage[i]);
+      }
+    }
+};
+
+#endif//reconstruction_hpp_20261017_160405_PDT
@@ -0,0 +1,135 @@
+#ifndef ring_mesher_hpp_20261017_171530_PDT
+#define ring_mesher_hpp_20261017_171530_PDT
+
+#include "reconstruction.hpp"
+#include "scan_frame.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// Builds a Wavefront OBJ mesh while the scan is running.
+//
+// scan.run samples a full platform revolution at one carriage position before
+// raising the carriage, so a change of carriage position closes a ring.  Each
+// closed ring is converted, its vertices written, and it is stitched to the
+// ring below with a strip of triangles; then it replaces that ring.  Only the
+// ring being sampled and the one below it are held in memory, and the output
+// is flushed per ring so the mesh grows on disk as layers arrive.
+//
+// Failed measurements are left out of their ring.  A ring with fewer than
+// three good points leaves a gap: the rings on either side are not joined.
+class RingMesher
+{
+public:
+  RingMesher(const Reconstruction& reconstruction, std::ostream& out)
+  : reconstruction_(reconstruction)
+  , out_(out)
+    {
+      out_ << "# 3dscan mesh, millimetres\n";
+    }
+
+  auto add(const ScanFrame& f) -> void
+    {
+      if(samples_.size() != 0 && f.carriage_position != samples_.carriage_position.back())
+      {
+        close_ring();
+      }
+      reconstruction_.add(samples_, f);
+    }
+  // close the last ring; call once the scan has ended
+  auto finish() -> void
+    {
+      if(samples_.size() != 0)
+      {
+        close_ring();
+      }
+      out_.flush();
+    }
+  auto vertices() const  -> uint64_t { return vertices_;  }
+  auto triangles() const -> uint64_t { return triangles_; }
+private:
+  struct RingVertex
+  {
+    uint16_t  platform_step;
+    uint64_t  index;          // 1-based OBJ vertex number
+  };
+
+  const Reconstruction&   reconstruction_;
+  std::ostream&           out_;
+  SampleColumns           samples_;       // ring being sampled
+  PointCloud              points_;
+  std::vector<RingVertex> ring_;          // ring being closed, in angle order
+  std::vector<RingVertex> below_;         // previous ring, in angle order
+  uint64_t                vertices_   = 0;
+  uint64_t                triangles_  = 0;
+
+  auto close_ring() -> void
+    {
+      points_.clear();
+      reconstruction_.update(samples_, points_);
+      ring_.clear();
+      for(size_t i = 0; i < points_.size(); ++i)
+      {
+        if(points_.status[i] == 0)
+        {
+          out_ << "v " << points_.x[i] << ' ' << points_.y[i] << ' ' << points_.z[i] << '\n';
+          ring_.push_back(RingVertex { samples_.platform_step[i], ++vertices_ });
+        }
+      }
+      samples_.clear();
+      // a scan need not start at platform step 0, so the ring can wrap
+      std::stable_sort(ring_.begin(), ring_.end(),
+        [](const RingVertex& a, const RingVertex& b) { return a.platform_step < b.platform_step; }
+      );
+      if(ring_.size() < 3)
+      {
+        ring_.clear();
+      }
+      if(!ring_.empty() && !below_.empty())
+      {
+        stitch(below_, ring_);
+      }
+      std::swap(below_, ring_);
+      out_.flush();
+    }
+  // Join two closed rings with a triangle strip, always advancing along the
+  // ring whose next vertex is at the smaller angle.  Winding gives outward
+  // normals for rings ordered by increasing platform step and height.
+  auto stitch(const std::vector<RingVertex>& lower, const std::vector<RingVertex>& upper) -> void
+    {
+      const auto  revolution  = static_cast<uint64_t>(reconstruction_.geometry().platform_steps);
+      const auto  nl          = lower.size();
+      const auto  nu          = upper.size();
+      auto angle = [&](const std::vector<RingVertex>& ring, size_t k)
+        {
+          return ring[k % ring.size()].platform_step + (k / ring.size()) * revolution;
+        };
+      auto vertex = [&](const std::vector<RingVertex>& ring, size_t k)
+        {
+          return ring[k % ring.size()].index;
+        };
+      size_t i = 0;
+      size_t j = 0;
+      while(i < nl || j < nu)
+      {
+        if(j == nu || (i < nl && angle(lower, i + 1) <= angle(upper, j + 1)))
+        {
+          face(vertex(lower, i), vertex(lower, i + 1), vertex(upper, j));
+          ++i;
+        }
+        else
+        {
+          face(vertex(lower, i), vertex(upper, j + 1), vertex(upper, j));
+          ++j;
+        }
+      }
+    }
+  auto face(uint64_t a, uint64_t b, uint64_t c) -> void
+    {
+      out_ << "f " << a << ' ' << b << ' ' << c << '\n';
+      ++triangles_;
+    }
+};
+
+#endif//ring_mesher_hpp_20261017_171530_PDT
@@ -0,0 +1 @@
+../3d-scanner-arduino-mega2560/scan_frame.hpp
\ No newline at end of file
@@ -0,0 +1,138 @@
+#ifndef scan_output_hpp_20261017_193105_PDT
+#define scan_output_hpp_20261017_193105_PDT
+
+#include "async_writer.hpp"
+#include "point_writer.hpp"
+#include "reconstruction.hpp"
+#include "ring_mesher.hpp"
+#include "scan_frame.hpp"
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+enum class OutputFormat
+{
+  raw,      // sample lines
+  xyz,      // point lines
+  ply,      // binary PLY points
+  columns,  // mmap-able point columns
+  obj       // mesh, built while scanning
+};
+
+inline auto parse_output_format(const std::string& name) -> OutputFormat
+{
+  if(name == "raw")     { return OutputFormat::raw;     }
+  if(name == "xyz")     { return OutputFormat::xyz;     }
+  if(name == "ply")     { return OutputFormat::ply;     }
+  if(name == "columns") { return OutputFormat::columns; }
+  if(name == "obj")     { return OutputFormat::obj;     }
+  throw std::runtime_error("Unknown output format: " + name);
+}
+
+// Everything done with one scanner's samples: add() is fed every frame (on
+// a capture worker thread), finish() completes the output once the scan is
+// over.  Formatted output goes through an AsyncWriter to the file at path,
+// or to standard output if path is empty; the client's own messages and the
+// scanner's text all go to standard error, so they never mix with it.
+class ScanOutput
+{
+public:
+  ScanOutput(OutputFormat format, const std::string& path, const ScanGeometry& geometry)
+  : format_(format)
+  , path_(path)
+  , file_(open_file(format, path))
+  , writer_(path.empty()? std::cout : file_)
+  , reconstruction_(geometry)
+    {
+      if(format_ == OutputFormat::obj)
+      {
+        mesher_.emplace(reconstruction_, writer_.stream());
+      }
+    }
+  ScanOutput(const ScanOutput&) = delete;
+  auto operator=(const ScanOutput&) -> ScanOutput& = delete;
+
+  auto add(const ScanFrame& f) -> void
+    {
+      switch(format_)
+      {
+      case OutputFormat::raw:
+        write_raw_sample(writer_.stream(), f);
+        break;
+      case OutputFormat::obj:
+        mesher_->add(f);
+        break;
+      default:
+        reconstruction_.add(samples_, f);
+      }
+    }
+  auto finish() -> void
+    {
+      auto& out = writer_.stream();
+      if(mesher_)
+      {
+        mesher_->finish();
+      }
+      else if(format_ != OutputFormat::raw)
+      {
+        PointCloud points;
+        reconstruction_.update(samples_, points);
+        samples_ = SampleColumns();
+        switch(format_)
+        {
+        case OutputFormat::xyz:
+          write_xyz(out, points);
+          break;
+        case OutputFormat::ply:
+          write_ply(out, points);
+          break;
+        default:
+          write_columns(path_, points);
+        }
+      }
+      try
+      {
+        writer_.close();
+      }
+      catch(const std::exception&)
+      {
+        throw std::runtime_error("Could not write " + (path_.empty()? std::string("standard output") : path_));
+      }
+    }
+  auto writer_stats() const -> QueueStats { return writer_.stats(); }
+private:
+  OutputFormat              format_;
+  std::string               path_;
+  std::ofstream             file_;
+  AsyncWriter               writer_;
+  Reconstruction            reconstruction_;
+  SampleColumns             samples_;
+  std::optional<RingMesher> mesher_;
+
+  static auto open_file(OutputFormat format, const std::string& path) -> std::ofstream
+    {
+      std::ofstream file;
+      if(format == OutputFormat::columns)
+      {
+        // written through a mapping in finish()
+        if(path.empty())
+        {
+          throw std::runtime_error("The columns format needs an output file");
+        }
+        return file;
+      }
+      if(!path.empty())
+      {
+        file.open(path, std::ios::binary);
+        if(!file)
+        {
+          throw std::runtime_error("Could not open output file: " + path);
+        }
+      }
+      return file;
+    }
+};
+
+#endif//scan_output_hpp_20261017_193105_PDT
@@ -0,0 +1,135 @@
+#ifndef serial_port_hpp_20261017_140312_PDT
+#define serial_port_hpp_20261017_140312_PDT
+
+#include <termios.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+// Raw, non-blocking handle on the scanner's tty.  Reads and writes never
+// block; callers wait for readiness with poll() on fd().  The port's termios
+// settings are restored when the handle is destroyed.
+class SerialPort
+{
+public:
+  SerialPort(const std::string& path, speed_t baud = B115200)
+  : path_(path)
+    {
+      using namespace std;
+      fd_ = open(path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+      if(fd_ == -1)
+      {
+        string msg = "Could not open port for input: ";
+        msg += path;
+        throw runtime_error(msg);
+      }
+      if(tcgetattr(fd_, &saved_options_) != 0)
+      {
+        close(fd_);
+        throw runtime_error("Could not save TTY options: tcgetattr() failed");
+      }
+      // equivalent of:
+      // stty -F /dev/ttyUSB0 raw cs8 115200 -hupcl clocal -crtscts -ixon
+      termios options = saved_options_;
+      cfmakeraw(&options);
+      options.c_cflag &= ~(HUPCL | CRTSCTS); // prevent arduino reboot on connection
+      options.c_cflag |= CLOCAL | CREAD;
+      options.c_cc[VMIN]  = 0;
+      options.c_cc[VTIME] = 0;
+      if(cfsetspeed(&options, baud) != 0)
+      {
+        close(fd_);
+        throw runtime_error("Could not set baud rate");
+      }
+      if(tcsetattr(fd_, TCSANOW, &options) == -1)
+      {
+        close(fd_);
+        throw runtime_error("Could not set port options; tcsetattr failed");
+      }
+    }
+  SerialPort(const SerialPort&) = delete;
+  auto operator=(const SerialPort&) -> SerialPort& = delete;
+  ~SerialPort()
+    {
+      if(tcsetattr(fd_, TCSANOW, &saved_options_) == -1)
+      {
+        std::cerr << "WARNING: Could not restore saved port options; tcsetattr failed" << std::endl;
+      }
+      close(fd_);
+    }
+
+  // switch the line rate, once anything already written has gone out
+  auto set_baud(unsigned rate) -> void
+    {
+      termios options;
+      if(tcgetattr(fd_, &options) != 0
+      || cfsetspeed(&options, speed_of(rate)) != 0
+      || tcsetattr(fd_, TCSADRAIN, &options) != 0)
+      {
+        throw std::runtime_error("Could not set baud rate " + std::to_string(rate) + " on " + path_);
+      }
+    }
+  static auto speed_of(unsigned rate) -> speed_t
+    {
+      switch(rate)
+      {
+      case 9600:    return B9600;
+      case 19200:   return B19200;
+      case 38400:   return B38400;
+      case 57600:   return B57600;
+      case 115200:  return B115200;
+      case 230400:  return B230400;
+#ifdef B500000
+      case 500000:  return B500000;
+#endif
+#ifdef B1000000
+      case 1000000: return B1000000;
+#endif
+      default:
+        throw std::runtime_error("Baud rate not supported by this host: " + std::to_string(rate));
+      }
+    }
+
+  auto fd() const   -> int                { return fd_;   }
+  auto path() const -> const std::string& { return path_; }
+
+  // Both return the number of bytes transferred; 0 when the call would block.
+  auto read_some(void* buffer, size_t size) -> size_t
+    {
+      auto n = ::read(fd_, buffer, size);
+      return checked(n, "read");
+    }
+  auto write_some(const void* buffer, size_t size) -> size_t
+    {
+      auto n = ::write(fd_, buffer, size);
+      return checked(n, "write");
+    }
+private:
+  std::string path_;
+  int         fd_ = -1;
+  termios     saved_options_;
+
+  auto checked(ssize_t n, const char* what) -> size_t
+    {
+      if(n >= 0)
+      {
+        return static_cast<size_t>(n);
+      }
+      if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+      {
+        return 0;
+      }
+      std::string msg = "Serial port ";
+      msg += what;
+      msg += " failed: ";
+      msg += std::strerror(errno);
+      throw std::runtime_error(msg);
+    }
+};
+
+#endif//serial_port_hpp_20261017_140312_PDT
@@ -0,0 +1,284 @@
+#ifndef spsc_queue_hpp_20261017_183002_PDT
+#define spsc_queue_hpp_20261017_183002_PDT
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+// Counters kept by a queue; read them once both ends are done.
+struct QueueStats
+{
+  size_t                    items       = 0;  // values passed through
+  size_t                    max_depth   = 0;  // most values waiting at once
+  size_t                    full_waits  = 0;  // pushes that found the queue full
+  std::chrono::nanoseconds  total_latency {0};// time values spent queued
+  std::chrono::nanoseconds  max_latency   {0};
+};
+
+inline auto operator<<(std::ostream& out, const QueueStats& s) -> std::ostream&
+{
+  using namespace std::chrono;
+  auto mean = s.items == 0? 0.0 : duration<double, std::micro>(s.total_latency).count() / s.items;
+  return out << s.items << " items, max depth " << s.max_depth
+             << ", " << s.full_waits << " full waits, latency mean "
+             << mean << " us, max " << duration<double, std::micro>(s.max_latency).count() << " us";
+}
+
+// Lets one thread sleep until others have something for it.  notify() only
+// takes the lock when the waiter is actually asleep, so a busy waiter costs
+// its notifiers a fence and a load, and an idle one costs no CPU at all.
+class WakeSignal
+{
+public:
+  using clock = std::chrono::steady_clock;
+
+  // sleeps until ready() holds, for at most timeout; ready() is checked
+  // first, and only reads state the notifiers publish before notify()
+template<typename ReadyF>
+  auto wait(ReadyF&& ready, clock::duration timeout) -> bool
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      waiting_.store(true, std::memory_order_relaxed);
+      // pairs with the fence in notify(): either the notifier sees
+      // waiting_, or ready() sees what the notifier published
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      auto result = cv_.wait_for(lock, timeout, ready);
+      waiting_.store(false, std::memory_order_relaxed);
+      return result;
+    }
+  auto notify() -> void
+    {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if(waiting_.load(std::memory_order_relaxed))
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cv_.notify_one();
+      }
+    }
+private:
+  std::mutex              mutex_;
+  std::condition_variable cv_;
+  std::atomic<bool>       waiting_ {false};
+};
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread.  Each side owns one index and only reads the other's, so a push or
+// pop is a couple of atomic loads and one release store.  The blocking
+// push/pop spin briefly, then sleep on a WakeSignal that the other side rings
+// after every push or pop; it only takes a lock when the waiter really is
+// asleep, which in a running pipeline means on the empty to non-empty edge.
+// A consumer serving several queues can have them all ring one signal of its
+// own (set_consumer_signal()).
+//
+// Besides moving values in and out, either side can work on a slot in place:
+// the producer fills back() and publishes it with push_back(), the consumer
+// reads front() and releases it with pop_front().  A large value (an input
+// block) then never has to be copied through the queue.
+template<typename T, size_t N>
+class SpscQueue
+{
+  static_assert(N != 0 && (N & (N - 1)) == 0, "queue size must be a power of two");
+public:
+  using clock = std::chrono::steady_clock;
+
+  SpscQueue()
+  : slots_(new Slot[N])
+    {
+    }
+  SpscQueue(const SpscQueue&) = delete;
+  auto operator=(const SpscQueue&) -> SpscQueue& = delete;
+
+  // producer side
+  // the slot the next push_back() publishes, or nullptr while the queue is full
+  auto back() -> T*
+    {
+      auto tail = tail_.load(std::memory_order_relaxed);
+      if(tail - head_.load(std::memory_order_acquire) == N)
+      {
+        return nullptr;
+      }
+      return &slots_[tail & (N - 1)].value;
+    }
+  // waits for back() to have room; nullptr once cancel is set
+  auto wait_back(const std::atomic<bool>* cancel = nullptr) -> T*
+    {
+      auto slot = back();
+      if(slot != nullptr)
+      {
+        return slot;
+      }
+      ++producer_.full_waits;
+      for(int spins = 0; (slot = back()) == nullptr; ++spins)
+      {
+        if(cancel != nullptr && cancel->load())
+        {
+          return nullptr;
+        }
+        if(spins < spin_limit_)
+        {
+          std::this_thread::yield();
+        }
+        else
+        {
+          // cancel has no signal of its own; look at it now and then
+          not_full_.wait([this] { return back() != nullptr; }, cancel_check_);
+        }
+      }
+      return slot;
+    }
+  // publish the slot filled through back()
+  auto push_back() -> void
+    {
+      auto tail   = tail_.load(std::memory_order_relaxed);
+      auto depth  = tail - head_.load(std::memory_order_acquire) + 1;
+      slots_[tail & (N - 1)].queued = clock::now();
+      if(depth > producer_.max_depth)
+      {
+        producer_.max_depth = depth;
+      }
+      tail_.store(tail + 1, std::memory_order_release);
+      not_empty_->notify();
+    }
+  auto try_push(T&& value) -> bool
+    {
+      auto slot = back();
+      if(slot == nullptr)
+      {
+        return false;
+      }
+      *slot = std::move(value);
+      push_back();
+      return true;
+    }
+  // waits for room; gives up (returning false) once cancel is set
+  auto push(T value, const std::atomic<bool>* cancel = nullptr) -> bool
+    {
+      auto slot = wait_back(cancel);
+      if(slot == nullptr)
+      {
+        return false;
+      }
+      *slot = std::move(value);
+      push_back();
+      return true;
+    }
+  // no more pushes will follow
+  auto close() -> void
+    {
+      closed_.store(true, std::memory_order_release);
+      not_empty_->notify();
+    }
+
+  // consumer side
+  // the oldest value, left in place until pop_front(); nullptr when empty
+  auto front() -> T*
+    {
+      auto head = head_.load(std::memory_order_relaxed);
+      if(head == tail_.load(std::memory_order_acquire))
+      {
+        return nullptr;
+      }
+      return &slots_[head & (N - 1)].value;
+    }
+  // waits up to timeout for front(); nullptr if none came, or the queue is drained
+  auto wait_front(clock::duration timeout) -> T*
+    {
+      for(int spins = 0; spins < spin_limit_; ++spins)
+      {
+        if(auto slot = front())
+        {
+          return slot;
+        }
+        if(drained())
+        {
+          return nullptr;
+        }
+        std::this_thread::yield();
+      }
+      not_empty_->wait([this] { return front() != nullptr || drained(); }, timeout);
+      return front();
+    }
+  // release the slot front() returned to the producer
+  auto pop_front() -> void
+    {
+      auto head     = head_.load(std::memory_order_relaxed);
+      auto latency  = clock::now() - slots_[head & (N - 1)].queued;
+      ++consumer_.items;
+      consumer_.total_latency += latency;
+      if(latency > consumer_.max_latency)
+      {
+        consumer_.max_latency = latency;
+      }
+      head_.store(head + 1, std::memory_order_release);
+      not_full_.notify();
+    }
+  auto try_pop(T& value) -> bool
+    {
+      auto slot = front();
+      if(slot == nullptr)
+      {
+        return false;
+      }
+      value = std::move(*slot);
+      pop_front();
+      return true;
+    }
+  // false if nothing arrived within timeout, or the queue is drained
+  auto pop(T& value, clock::duration timeout) -> bool
+    {
+      auto slot = wait_front(timeout);
+      if(slot == nullptr)
+      {
+        return false;
+      }
+      value = std::move(*slot);
+      pop_front();
+      return true;
+    }
+  // the signal push_back() and close() ring instead of the queue's own; set
+  // it before either side starts
+  auto set_consumer_signal(WakeSignal& signal) -> void
+    {
+      not_empty_ = &signal;
+    }
+  // closed and empty: nothing more will ever be popped
+  auto drained() const -> bool
+    {
+      return closed_.load(std::memory_order_acquire)
+          && head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_acquire);
+    }
+
+  auto stats() const -> QueueStats
+    {
+      auto s        = consumer_;
+      s.max_depth   = producer_.max_depth;
+      s.full_waits  = producer_.full_waits;
+      return s;
+    }
+private:
+  struct Slot
+  {
+    T                   value;
+    clock::time_point   queued;
+  };
+
+  std::unique_ptr<Slot[]>           slots_;
+  alignas(64) std::atomic<size_t>   head_   {0};  // written by the consumer
+  QueueStats                        consumer_;
+  alignas(64) std::atomic<size_t>   tail_   {0};  // written by the producer
+  QueueStats                        producer_;
+  alignas(64) std::atomic<bool>     closed_ {false};
+  WakeSignal                        own_not_empty_;
+  WakeSignal*                       not_empty_  = &own_not_empty_;
+  WakeSignal                        not_full_;
+
+  static constexpr int              spin_limit_   = 64;
+  static constexpr clock::duration  cancel_check_ = std::chrono::milliseconds(50);
+};
+
+#endif//spsc_queue_hpp_20261017_183002_PDT
@@ -0,0 +1,125 @@
+#ifndef stream_decoder_hpp_20261017_140527_PDT
+#define stream_decoder_hpp_20261017_140527_PDT
+
+#include "input_buffer.hpp"
+#include "log_record.hpp"
+#include "scan_frame.hpp"
+#include <functional>
+#include <string>
+#include <string_view>
+
+// Splits the byte stream from the scanner into binary sample frames and the
+// text lines (log messages, "#..." markers) interleaved with them.  Both are
+// parsed in place in the InputBuffer: frames are decoded straight from it and
+// lines are passed on as views that are only valid during the callback.
+// Binary log records are rendered back into the text line they stand for.
+class StreamDecoder
+{
+public:
+  using frame_callback_t  = std::function<void(const ScanFrame&)>;
+  using line_callback_t   = std::function<void(std::string_view)>;
+
+  StreamDecoder(frame_callback_t on_frame, line_callback_t on_line)
+  : on_frame_(std::move(on_frame))
+  , on_line_(std::move(on_line))
+    {
+    }
+
+  // Consume every complete frame and line in the buffer; a trailing partial
+  // one is left for the next call.
+  auto decode(InputBuffer& in) -> void
+    {
+      while(!in.empty())
+      {
+        auto data = in.data();
+        auto size = in.size();
+        if(data[0] == ScanFrame::sync_)
+        {
+          if(size < ScanFrame::size_)
+          {
+            return;
+          }
+          // a false sync costs one byte; rescan whatever followed it
+          in.consume(decode_frame(data)? ScanFrame::size_ : 1);
+          continue;
+        }
+        if(data[0] == LogRecord::sync_)
+        {
+          auto record_size = LogRecord::size_of(data, size);
+          if(record_size == 0 || size < record_size)
+          {
+            return;
+          }
+          in.consume(decode_record(data)? record_size : 1);
+          continue;
+        }
+        // A line ends at its newline, or early at a sync byte, which never
+        // occurs in the firmware's ASCII output.
+        auto text = reinterpret_cast<const char*>(data);
+        size_t n  = 0;
+        while(n < size && text[n] != '\n' && data[n] != ScanFrame::sync_ && data[n] != LogRecord::sync_)
+        {
+          ++n;
+        }
+        if(n == size && !in.full())
+        {
+          return;
+        }
+        auto line = std::string_view(text, n);
+        if(!line.empty() && line.back() == '\r')
+        {
+          line.remove_suffix(1);
+        }
+        on_line_(line);
+        in.consume(n < size && text[n] == '\n'? n + 1 : n);
+      }
+    }
+  auto frames() const         -> size_t { return frames_;         }
+  auto bad_frames() const     -> size_t { return bad_frames_;     }
+  auto dropped_frames() const -> size_t { return dropped_frames_; }
+private:
+  frame_callback_t                      on_frame_;
+  line_callback_t                       on_line_;
+  bool                                  have_sequence_  = false;
+  uint16_t                              next_sequence_  = 0;
+  size_t                                frames_         = 0;
+  size_t                                bad_frames_     = 0;
+  size_t                                dropped_frames_ = 0;
+  std::string                           record_line_;
+
+  auto decode_frame(const uint8_t* data) -> bool
+    {
+      ScanFrame frame;
+      if(!ScanFrame::decode(data, frame))
+      {
+        ++bad_frames_;
+        return false;
+      }
+      if(have_sequence_ && frame.sequence != next_sequence_)
+      {
+        dropped_frames_ += static_cast<uint16_t>(frame.sequence - next_sequence_);
+      }
+      have_sequence_  = true;
+      next_sequence_  = frame.sequence + 1;
+      ++frames_;
+      on_frame_(frame);
+      return true;
+    }
+  auto decode_record(const uint8_t* data) -> bool
+    {
+      LogRecord record;
+      if(!LogRecord::decode(data, record))
+      {
+        return false;
+      }
+      record_line_.clear();
+      record.render(
+        [this](const char* text, size_t length) { record_line_.append(text, length); },
+        [this](int32_t value) { record_line_ += std::to_string(value); }
+      );
+      on_line_(record_line_);
+      return true;
+    }
+};
+
+#endif//stream_decoder_hpp_20261017_140527_PDT